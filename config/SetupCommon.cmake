@@ -99,8 +99,14 @@ set(common_source
     util/directio.hpp
     util/errors.cpp
     util/errors.hpp
+    util/jobscheduler.hpp
     util/ldio.hpp
+    util/mappedfile.hpp
+    util/paramshash.hpp
+    util/progress.hpp
     util/prtfileemu.hpp
+    util/threadpool.cpp
+    util/threadpool.hpp
     util/timing.cpp
     util/timing.hpp
     util/unformattedio.hpp
@@ -49,10 +49,9 @@ int main()
     init.outputCallback    = OutputCallback;
     init.prtCallback       = PrtCallback;
     init.completedCallback = CompletedCallback;
+    init.blocking          = false;
 
     bhc::setup(init, params, outputs);
-    // Awkward, but only rays are non-blocking.
-    outputs.rayinfo->blocking = false;
 
     strcpy(params.Beam->RunType, "RG   3");
 
@@ -0,0 +1,232 @@
+/*
+bellhopcxx / bellhopcuda - C++/CUDA port of BELLHOP(3D) underwater acoustics simulator
+Copyright (C) 2021-2023 The Regents of the University of California
+Marine Physical Lab at Scripps Oceanography, c/o Jules Jaffe, jjaffe@ucsd.edu
+Based on BELLHOP / BELLHOP3D, which is Copyright (C) 1983-2022 Michael B. Porter
+
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+
+/*
+Test of bhcInit::reuseRayFan. Runs a TL environment with the ray fan enabled,
+then changes the receiver depths and the influence type and runs it again,
+which reuses (or, for the influence type, traces again) the fan. Each result is
+compared to the result of a fresh setup and run on the same receivers.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// This define must be set before including the header if you're using the DLL
+// version on Windows, and it must NOT be set if you're using the static library
+// version on Windows. If you're not on Windows, it doesn't matter either way.
+#define BHC_DLL_IMPORT 1
+#include <bhc/bhc.hpp>
+
+void OutputCallback(const char *message)
+{
+    std::cout << "Out: " << message << std::endl << std::flush;
+}
+
+void PrtCallback(const char *) {}
+
+static bhc::bhcInit init;
+static std::string FileRoot;
+
+/**
+ * Second receiver grid: about half as many depths, offset from the original
+ * ones, over the same span.
+ */
+template<bool O3D> void ChangeReceivers(bhc::bhcParams<O3D> &params)
+{
+    bhc::Position *Pos = params.Pos;
+    float zMin         = Pos->Rz[0];
+    float zMax         = Pos->Rz[Pos->NRz - 1];
+    int32_t NRz        = std::max(Pos->NRz / 2, 2);
+    bhc::extsetup_rcvrdepths<O3D>(params, NRz);
+    for(int32_t iz = 0; iz < NRz; ++iz) {
+        Pos->Rz[iz] = zMin + ((float)iz + 0.5f) * (zMax - zMin) / (float)NRz;
+    }
+}
+
+/**
+ * Switches between the geometric hat beams in Cartesian coordinates, for which
+ * the rays are traced with q = 0 (see RayInit), and in ray-centered coordinates.
+ */
+template<bool O3D> void ChangeInfluence(bhc::bhcParams<O3D> &params)
+{
+    char &t = params.Beam->RunType[1];
+    t       = t == 'G' ? 'g' : 'G';
+}
+
+template<bool O3D, bool R3D> bool CopyField(
+    const bhc::bhcParams<O3D> &params, const bhc::bhcOutputs<O3D, R3D> &outputs,
+    std::vector<bhc::cpxf> &field)
+{
+    const bhc::Position *Pos = params.Pos;
+    size_t n = (size_t)Pos->NSz * (size_t)Pos->NSx * (size_t)Pos->NSy
+        * (size_t)Pos->Ntheta * (size_t)Pos->NRz_per_range * (size_t)Pos->NRr;
+    if(outputs.uAllSources == nullptr || n == 0) {
+        std::cout << "No TL field\n";
+        return false;
+    }
+    field.assign(outputs.uAllSources, outputs.uAllSources + n);
+    return true;
+}
+
+/**
+ * Fresh setup and run of the environment with the changes, to compare against.
+ */
+template<bool O3D, bool R3D> bool RunFresh(
+    bool changeRcvrs, bool changeInfl, std::vector<bhc::cpxf> &field)
+{
+    bhc::bhcParams<O3D> params;
+    bhc::bhcOutputs<O3D, R3D> outputs;
+    bhc::bhcInit freshInit = init;
+    freshInit.reuseRayFan  = false;
+    if(!bhc::setup<O3D, R3D>(freshInit, params, outputs)) return false;
+    if(changeRcvrs) ChangeReceivers<O3D>(params);
+    if(changeInfl) ChangeInfluence<O3D>(params);
+    bool ok = bhc::run<O3D, R3D>(params, outputs)
+        && CopyField<O3D, R3D>(params, outputs, field);
+    bhc::finalize<O3D, R3D>(params, outputs);
+    return ok;
+}
+
+bool Compare(const char *name, const std::vector<bhc::cpxf> &a,
+    const std::vector<bhc::cpxf> &b)
+{
+    if(a.size() != b.size()) {
+        std::cout << name << ": FAIL, field sizes " << a.size() << " and " << b.size()
+                  << "\n";
+        return false;
+    }
+    float maxVal = 0.0f, maxDiff = 0.0f;
+    for(size_t i = 0; i < a.size(); ++i) {
+        maxVal  = std::max(maxVal, std::abs(b[i]));
+        maxDiff = std::max(maxDiff, std::abs(a[i] - b[i]));
+    }
+    // LP: The rays are the same and the contributions are added in the same
+    // order, so this should be 0 in practice.
+    bool ok = maxDiff <= 1e-6f * maxVal;
+    std::cout << name << ": " << (ok ? "pass" : "FAIL") << ", max difference "
+              << maxDiff << " of max value " << maxVal << "\n";
+    return ok;
+}
+
+template<bool O3D, bool R3D> int mainmain()
+{
+    init.FileRoot       = FileRoot.c_str();
+    init.numThreads     = 1;
+    init.prtCallback    = PrtCallback;
+    init.outputCallback = OutputCallback;
+    init.reuseRayFan    = true;
+
+    bhc::bhcParams<O3D> params;
+    bhc::bhcOutputs<O3D, R3D> outputs;
+    if(!bhc::setup<O3D, R3D>(init, params, outputs)) return 1;
+    char rt = params.Beam->RunType[0];
+    if((rt != 'C' && rt != 'S' && rt != 'I') || params.Beam->RunType[4] == 'I'
+       || (params.Beam->RunType[1] != 'G' && params.Beam->RunType[1] != 'g')) {
+        std::cout << "The environment must be a TL run with a rectilinear receiver "
+                     "grid and geometric hat beams ('G' or 'g')\n";
+        bhc::finalize<O3D, R3D>(params, outputs);
+        return 1;
+    }
+    std::vector<bhc::cpxf> reused, fresh;
+    bool ok = bhc::run<O3D, R3D>(params, outputs);
+    // Second receiver grid, from the fan traced in the first run
+    ChangeReceivers<O3D>(params);
+    ok = ok && bhc::run<O3D, R3D>(params, outputs)
+        && CopyField<O3D, R3D>(params, outputs, reused)
+        && RunFresh<O3D, R3D>(true, false, fresh)
+        && Compare("Second receiver grid", reused, fresh);
+    // Different influence type, which must not reuse the fan
+    ChangeInfluence<O3D>(params);
+    ok = ok && bhc::run<O3D, R3D>(params, outputs)
+        && CopyField<O3D, R3D>(params, outputs, reused)
+        && RunFresh<O3D, R3D>(true, true, fresh)
+        && Compare("Other influence type", reused, fresh);
+    bhc::finalize<O3D, R3D>(params, outputs);
+    return ok ? 0 : 1;
+}
+
+void showhelp(const char *argv0)
+{
+    std::cout
+        << "rayfan - test of reusing the ray fan (bhcInit::reuseRayFan)\n"
+           "\n"
+           "Usage: "
+        << argv0
+        << " [options] FileRoot\n"
+           "FileRoot is the absolute or relative path to the input environment \n"
+           "file, minus the .env file extension, e.g. test/in/MunkB_Coh . It must\n"
+           "be a TL run with a rectilinear receiver grid and geometric hat beams.\n"
+           "The result on a second receiver grid computed from the reused ray fan\n"
+           "is compared to a fresh run, and likewise after changing the influence\n"
+           "type. Returns 0 if both match.\n"
+           "\n"
+           "-?, -h, -help: Shows this help message\n"
+           "-2, -2D: Does a 2D run. The environment file must also be 2D\n"
+           "-3, -3D: Does a 3D run. The environment file must also be 3D\n"
+           "-4, -Nx2D, -2D3D, -2.5D: Does a Nx2D run. The environment file must also be "
+           "Nx2D\n";
+}
+
+int main(int argc, char **argv)
+{
+    int dimmode = 0;
+    for(int32_t i = 1; i < argc; ++i) {
+        std::string s = argv[i];
+        if(argv[i][0] == '-') {
+            if(s.length() >= 2 && argv[i][1] == '-') { // two dashes
+                s = s.substr(1);
+            }
+            if(s == "-2" || s == "-2D") {
+                dimmode = 2;
+            } else if(s == "-Nx2D" || s == "-2D3D" || s == "-2.5D" || s == "-4") {
+                dimmode = 4;
+            } else if(s == "-3" || s == "-3D") {
+                dimmode = 3;
+            } else if(s == "-?" || s == "-h" || s == "-help") {
+                showhelp(argv[0]);
+                return 0;
+            } else {
+                std::cout << "Unknown command-line option \"-" << s << "\", try "
+                          << argv[0] << " --help\n";
+                return 1;
+            }
+        } else if(FileRoot.empty()) {
+            FileRoot = s;
+        } else {
+            std::cout << "Error, received another command-line argument \"" << s
+                      << "\", already have FileRoot = \"" << FileRoot << "\"\n";
+            return 1;
+        }
+    }
+    if(FileRoot.empty()) {
+        std::cout << "Must provide FileRoot as command-line parameter, try " << argv[0]
+                  << " --help\n";
+        return 1;
+    }
+    if(dimmode < 2 || dimmode > 4) {
+        std::cout << "No dimensionality specified (--2D, --Nx2D, --3D), assuming 2D\n";
+        dimmode = 2;
+    }
+    if(dimmode == 2) { return mainmain<false, false>(); }
+    if(dimmode == 3) { return mainmain<true, true>(); }
+    if(dimmode == 4) { return mainmain<true, false>(); }
+    return 1;
+}
@@ -88,6 +88,12 @@ extern template BHC_API bool setup<true, true>(
  *    originally in kilometers, but it may be in meters now.
  * Also, most arrays must be monotonically increasing along relevant axes (e.g.
  * bathymetry X and Y values must be monotonic but Z values can be arbitrary).
+ *
+ * Between calls to run(), the SSP, altimetry / bathymetry, reflection
+ * coefficients, and source beam pattern are not re-validated or re-preprocessed
+ * if their contents have not changed since the last successful run. So, when
+ * sweeping e.g. source positions or frequencies in a loop, the environment is
+ * only processed once.
  */
 
 /**
@@ -175,7 +181,8 @@ extern template BHC_API void extsetup_sbp<true>(bhcParams<true> &params, int32_t
  * (broadband mode) is not properly supported in BELLHOP(3D)--these values have
  * no impact on the physics model--but this feature cannot be removed from
  * bellhopcxx / bellhopcuda because the frequency vector is written to the
- * SHDFile.
+ * SHDFile. If bhcInit::broadbandTL is set, TL runs compute the field for every
+ * frequency in the vector; see there.
  */
 template<bool O3D> void extsetup_freqvec(bhcParams<O3D> &params, int32_t Nfreq);
 extern template BHC_API void extsetup_freqvec<false>(
@@ -230,6 +237,30 @@ extern template BHC_API void extsetup_trc<true>(bhcParams<true> &params, int32_t
 template<bool O3D> void extsetup_brc(bhcParams<O3D> &params, int32_t NPts);
 extern template BHC_API void extsetup_brc<false>(bhcParams<false> &params, int32_t NPts);
 extern template BHC_API void extsetup_brc<true>(bhcParams<true> &params, int32_t NPts);
+/**
+ * Reallocate the SSP to the given number of depths, for any mode other than
+ * quad or hexahedral (those have their own extsetup functions below). After
+ * calling this,
+ * - set params.ssp->Type to the correct letter
+ * - fill in params.ssp->z[:], .alphaR, .betaR, .rho, .alphaI, and .betaI
+ * - make sure params.Bdry->Top.hs.Depth is equal to ssp->z[0], and
+ *   params.Bdry->Bot.hs.Depth is equal to ssp->z[NPts-1]
+ *
+ * This function sets params.ssp->dirty, but if you change the SSP data later
+ * (not immediately after calling this function), you'll need to set the dirty
+ * flag each time it is changed.
+ *
+ * API change: previously, no extsetup call was needed for these modes, and
+ * params.ssp->NPts could be set directly, as the SSP arrays always had room
+ * for MaxSSP points. The arrays are now only as large as the number of points
+ * read from the environment file (at least 2), or as set by this function, so
+ * code which sets NPts directly must call this function instead. Otherwise,
+ * writing the points overruns the arrays; validation reports an error if NPts
+ * exceeds the allocated size.
+ */
+template<bool O3D> void extsetup_ssp(bhcParams<O3D> &params, int32_t NPts);
+extern template BHC_API void extsetup_ssp<false>(bhcParams<false> &params, int32_t NPts);
+extern template BHC_API void extsetup_ssp<true>(bhcParams<true> &params, int32_t NPts);
 /**
  * Set up and/or reallocate the SSP for quad mode (2D only). NPts is the number
  * of depths. Fill in params.ssp->z, params.ssp->Seg.r, and params.ssp->cMat[z *
@@ -244,14 +275,7 @@ extern template BHC_API void extsetup_brc<true>(bhcParams<true> &params, int32_t
  * (not immediately after calling this function), you'll need to set the dirty
  * flag each time it is changed.
  *
- * To set the SSP to a mode other than quad or hexahedral, an extsetup call is
- * not needed. Just
- * - set params.ssp->Type to the correct letter
- * - set params.ssp->NPts and fill in params->ssp.z[:], .alphaR, .betaR, .rho,
- *   .alphaI, and .betaI
- * - make sure the surface and bottom depths are set correctly as described
- *   above
- * - set the dirty flag
+ * To set the SSP to a mode other than quad or hexahedral, see extsetup_ssp().
  */
 extern BHC_API void extsetup_ssp_quad(bhcParams<false> &params, int32_t NPts, int32_t Nr);
 /**
@@ -270,8 +294,7 @@ extern BHC_API void extsetup_ssp_quad(bhcParams<false> &params, int32_t NPts, in
  * (not immediately after calling this function), you'll need to set the dirty
  * flag each time it is changed.
  *
- * To set the SSP to a mode other than quad or hexahedral, an extsetup call is
- * not needed; see the doc for extsetup_ssp_quad() for more info.
+ * To set the SSP to a mode other than quad or hexahedral, see extsetup_ssp().
  */
 extern BHC_API void extsetup_ssp_hexahedral(
     bhcParams<true> &params, int32_t Nx, int32_t Ny, int32_t Nz);
@@ -294,6 +317,14 @@ extern template BHC_API bool echo<true>(bhcParams<true> &params);
  * Runs the selected run type and places the results in the appropriate struct
  * within outputs.
  *
+ * If bhcInit::blocking was false, this returns after preprocessing and the rest
+ * of the run continues in the background, for any run type; see
+ * bhcInit::blocking and bhcInit::completedCallback. Errors from the background
+ * part are reported through the output callback.
+ *
+ * Rays, eigenrays, and each receiver's arrivals can also be passed to
+ * callbacks as they are completed; see bhcInit::rayCallback.
+ *
  * returns: false if an error occurred, true if no errors.
  */
 template<bool O3D, bool R3D> bool run(
@@ -312,11 +343,35 @@ extern template BHC_API bool run<true, true>(
 /**
  * Get the percent progress as an int. Thread safe.
  * Returns an int from 0 to 100.
+ *
+ * During run(), preprocessing covers 0-5%, tracing the rays 5-90%, and
+ * post-processing the results 90-100%, for every run type. During writeout(),
+ * the progress restarts from 0% and reaches 100% when the files are written.
  */
 template<bool O3D> int get_percent_progress(bhcParams<O3D> &params);
 extern template BHC_API int get_percent_progress<true>(bhcParams<true> &params);
 extern template BHC_API int get_percent_progress<false>(bhcParams<false> &params);
 
+/**
+ * Cancel the run in progress, if any; usually called from another thread
+ * during a blocking run, or during a non-blocking run. Thread safe. Has no
+ * effect on runs started afterwards.
+ *
+ * The CPU workers stop within one ray step and take no new rays, so the cores
+ * are freed almost immediately. (In CUDA builds, the kernel already launched
+ * runs to completion, but nothing after it does.) The run then fails in the
+ * usual way: run() returns false, or for a non-blocking run, the error is
+ * reported through the output callback and completedCallback is called.
+ *
+ * Afterwards, outputs remain allocated and consistent, so finalize() or another
+ * run() may be called normally. However, their contents are incomplete: they
+ * only include the rays traced before the cancellation and have not been
+ * post-processed, so they must not be used as results or written out.
+ */
+template<bool O3D> void cancel(bhcParams<O3D> &params);
+extern template BHC_API void cancel<true>(bhcParams<true> &params);
+extern template BHC_API void cancel<false>(bhcParams<false> &params);
+
 /**
  * Write results for the past run to BELLHOP-formatted files, i.e. a ray file,
  * a shade file, or an arrivals file. If you only want to use the results in
@@ -388,8 +443,10 @@ extern template BHC_API bool writeenv<true>(
     bhcParams<true> &params, const char *FileRoot);
 
 /**
- * Frees memory. You may call run() many times (with changed parameters), you do
- * not have to call setup - run - finalize every time.
+ * Frees memory and stops the worker threads. You may call run() many times
+ * (with changed parameters), you do not have to call setup - run - finalize
+ * every time. If a non-blocking run is still in progress, this waits for it to
+ * complete.
  */
 template<bool O3D, bool R3D> void finalize(
     bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs);
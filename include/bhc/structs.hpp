@@ -70,18 +70,48 @@ struct rxyz_vector {
     real *r, *x, *y, *z;
 };
 
+struct rxyz_scalar {
+    real r, x, y, z;
+};
+
+/**
+ * LP: Coefficients of the trilinear interpolation within one hexahedral SSP
+ * cell. Within the cell,
+ * c = a[0] + a[1] * s1 + a[2] * s2 + a[3] * s1 * s2, with a[i] = p[i] + q[i] * dz
+ * where s1 and s2 are the proportional distances in x and y and dz is the depth
+ * below the top of the cell. p is from cMat and q is from czMat, so one cell
+ * is read from one contiguous block instead of the 8 corners of cMat and czMat.
+ */
+struct HexSSPCoef {
+    real p[4], q[4];
+};
+
 struct SSPStructure {
-    // LP: Start with complex values for alignment reasons.
-    cpx c[MaxSSP], cz[MaxSSP], n2[MaxSSP], n2z[MaxSSP], cSpline[4][MaxSSP];
-    cpx cCoef[4][MaxSSP], CSWork[4][MaxSSP]; // for PCHIP coefs.
+    // LP: All per-depth arrays are allocated to the number of points actually
+    // in use (NPtsAlloc for the input data, NPts for the derived data), rather
+    // than MaxSSP each. cSpline, cCoef, and CSWork are only allocated for the
+    // SSP types which use them.
+    cpx *c, *cz, *n2, *n2z, *cSpline[4];
+    cpx *cCoef[4], *CSWork[4]; // for PCHIP coefs.
     real *cMat, *czMat; // LP: No need for separate cMat3 / czMat3 as we don't have to
                         // specify the dimension here.
     rxyz_vector Seg;
-    real z[MaxSSP], rho[MaxSSP];
-    real alphaR[MaxSSP], alphaI[MaxSSP];
+    // LP: 1 / spacing of z and of each Seg axis if that axis is uniformly
+    // spaced (to within half a segment), or 0 otherwise. Computed in preprocess
+    // and used to jump directly to the right segment.
+    real zInvDelta;
+    rxyz_scalar SegInvDelta;
+    // LP: Precomputed hexahedral interpolation coefficients for each cell, and
+    // 1 / width of each segment of Seg.x, y, and z (Seg.r unused). nullptr
+    // unless bhcInit::precomputeHexSSP.
+    HexSSPCoef *hexCoef;
+    rxyz_vector SegInvWidth;
+    real *z, *rho;
+    real *alphaR, *alphaI;
     // LP: Not actually used, but echoed, so with new system need to store them
-    real betaR[MaxSSP], betaI[MaxSSP];
+    real *betaR, *betaI;
 
+    int32_t NPtsAlloc;
     int32_t NPts, Nr, Nx, Ny, Nz;
     char Type;
     char AttenUnit[2];
@@ -275,6 +305,10 @@ struct AttenInfo {
 struct Position {
     int32_t NSx, NSy, NSz, NRz, NRr, Ntheta; // number of x, y, z, r, theta coordinates
     int32_t NRz_per_range;
+    /// LP: Set in preprocessing of TL runs. 0 normally; if the TL field is the
+    /// memory-mapped .shd file (bhcInit::mappedTLFile), the number of cpxf
+    /// values per .shd record.
+    int32_t TLRecCpxf;
     bool SxSyInKm, RrInKm; // Values in km, converted to meters in preprocess
     /// Whether a duplicate angle (e.g. 360.0 when 0.0 also exists) was removed
     /// while reading the environment file. If manually setting theta, set this
@@ -314,6 +348,9 @@ struct FreqInfo {
     real freq0;    // Nominal or carrier frequency
     int32_t Nfreq; // number of frequencies
     real *freqVec; // frequency vector for broadband runs
+    /// LP: Set in preprocessing of TL runs: the number of frequencies in the TL
+    /// field, Nfreq if bhcInit::broadbandTL, otherwise 1 (freq0 only).
+    int32_t NfreqTL;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -357,12 +394,18 @@ struct EigenHit {
     int32_t itheta, ir, iz;
     // LP: Identifying info to re-trace this ray
     int32_t isx, isy, isz, ialpha, ibeta;
+    // LP: Number of points of the ray up to this hit, the same as re-tracing
+    // it for is steps would give (used for single-pass eigenrays)
+    int32_t Nsteps;
 };
 
 struct EigenInfo {
     int32_t neigen;
     int32_t memsize;
     EigenHit *hits;
+    // LP: Whether ray trajectories are kept during the field pass instead of
+    // re-traced afterwards, see bhcInit::singlePassEigenrays
+    bool singlePass;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -375,6 +418,12 @@ struct Arrival {
     cpxf delay;
 };
 
+/**
+ * LP: Hits a CPU worker thread has recorded for merging after the run, see
+ * AddArr. Internal.
+ */
+struct ArrHitCursor;
+
 /**
  * LP: Arrival setup and results.
  */
@@ -383,6 +432,9 @@ struct ArrInfo {
     int32_t *NArr;
     int32_t *MaxNPerSource;
     int32_t MaxNArr;
+    // LP: Always true on the CPU: multithreaded runs record the hits and
+    // merge them in ray order after the run (see MergeArrHits), so the result
+    // is the same as a single-threaded run.
     bool AllowMerging;
 };
 
@@ -434,15 +486,35 @@ template<bool O3D, bool R3D> struct RayResult {
     int32_t Nsteps;
 };
 
+/**
+ * LP: The part [begin, end) of RayMem which a worker thread is tracing rays
+ * into, when not in copy mode.
+ */
+struct RayMemChunk {
+    size_t begin, end;
+};
+
 template<bool O3D, bool R3D> struct RayInfo {
     RayResult<O3D, R3D> *results;
     rayPt<R3D> *RayMem;
     rayPt<R3D> *WorkRayMem;
+    RayMemChunk *WorkerChunks;
     size_t RayMemCapacity;
     size_t RayMemPoints;
     int32_t MaxPointsPerRay;
     int32_t NRays;
     bool isCopyMode;
+    /// LP: Rays are only passed to bhcInit::rayCallback, not kept (see
+    /// bhcInit::keepStreamedRays).
+    bool isStreamOnly;
+    /// LP: RayMem holds the ray fan of a TL or arrivals run (see
+    /// bhcInit::reuseRayFan). fanTraced is set once it has been traced, in
+    /// the environment identified by fanKey.
+    bool isRayFan;
+    bool fanTraced;
+    uint64_t fanKey;
+    /// Deprecated: setting this to false makes ray runs non-blocking, the same
+    /// as bhcInit::blocking = false.
     bool blocking = true;
 };
 
@@ -452,6 +524,32 @@ struct RayInitInfo {
     real SrcDeclAngle, SrcAzimAngle;
 };
 
+/**
+ * LP: Per-thread cache of the parts of RayInit which depend on the source but
+ * not on the ray's angles: the SSP at the source, and the boundary segments
+ * above and below it. The rays of one source are consecutive jobs (see
+ * GetJobIndices), and each worker takes contiguous ranges of jobs, so all but
+ * the first ray of each source use the cached values. When the source changes,
+ * the segment searches start from the segments found for the previous source,
+ * which is usually nearby, rather than from the first segment. The searches
+ * find the same segment from any starting point, so results are unchanged.
+ *
+ * A source exactly on a segment boundary is in the segment the ray starts out
+ * towards, so there is an entry for each DirClass of the starting direction.
+ */
+template<bool O3D> struct RaySourceCache {
+    int32_t isx, isy, isz; // Source the entries are for; isz = -1 for none
+    bool sspValid[4], bdryValid[4];
+    SSPOutputs<O3D> o[4];
+    SSPSegState iSeg[4];
+    BdryState<O3D> bds[4];
+    BdryType Bdry[4];
+    real DistBegTop[4], DistBegBot[4];
+    // LP: Segments found most recently, where the next searches start.
+    SSPSegState iSegHint;
+    IORI2<O3D> topIsegHint, botIsegHint;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 // Influence / transmission loss
 ////////////////////////////////////////////////////////////////////////////////
@@ -464,11 +562,16 @@ template<bool R3D> struct InfluenceRayInfo {
     cpx epsilon1, epsilon2; // beam constant
     VEC23<R3D> xs;          // source
     real freq0, omega;
+    int32_t Nfreq;          // LP: > 1 for broadband TL runs
+    const real *freqVec;    // LP: only used if Nfreq > 1
+    size_t fieldSize;       // LP: offset between frequencies in the TL field
     real RadMax;
     real BeamWindow;
     int32_t iBeamWindow2;
     real Ratio1; // scale factor (point source vs. line source)
     real rcp_q0, rcp_qhat0;
+    bool uPrivate; // LP: Field is only written by this thread, no atomics needed
+    ArrHitCursor *arrCursor; // LP: This thread's recorded hits, see AddArr
     // LP: Variables carried over between iterations.
     real phase;
     real qOld;               // LP: Det_QOld in 3D
@@ -478,6 +581,11 @@ template<bool R3D> struct InfluenceRayInfo {
     bool lastValid;
     int32_t kmah;
     int32_t ir;
+    // LP: Eigenrays: is + this is the number of points a re-trace would give
+    // (2, or 3 on the second half of a double step), and the largest such
+    // number for any hit on this ray so far.
+    int32_t eigenStepPoints;
+    int32_t eigenMaxPoints;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -485,16 +593,98 @@ template<bool R3D> struct InfluenceRayInfo {
 ////////////////////////////////////////////////////////////////////////////////
 
 struct bhcInit {
-    /// Number of worker threads to run. -1 means "all logical cores".
+    /// Number of worker threads to run. -1 means "all logical cores". The
+    /// threads are created in bhc::setup(), reused for every bhc::run(), and
+    /// joined in bhc::finalize().
     int32_t numThreads = -1;
     /// Maximum amount of memory (in bytes) this instance should use.
     size_t maxMemory = 4ull * 1024ull * 1024ull * 1024ull; // 4 GiB
-    /// If there is not enough memory to hold the requested number of rays
-    /// where each is maximum length, whether to solve this by reducing the
-    /// maximum length (false), or by using copy mode (true). Copy mode can fit
-    /// more ray data in memory but is slower. This only affects ray and
-    /// eigenray runs (no effect on TL or arrivals).
+    /// Ray and eigenray runs normally trace each ray directly into a shared
+    /// pool of ray memory, which each ray only uses as much of as it needs. If
+    /// there is not enough memory to hold the requested number of rays where
+    /// each is maximum length, this option instead traces each ray into a
+    /// per-thread buffer of maximum length and then copies it into the pool
+    /// ("copy mode"). Copy mode packs the rays slightly more tightly but is
+    /// slower. No effect on TL or arrivals runs.
     bool useRayCopyMode = false;
+    /// Eigenray runs (and arrivals runs which also produce eigenrays) normally
+    /// record which rays hit receivers during the field pass, and then re-trace
+    /// each of those rays to get its trajectory. If true, the trajectory of
+    /// each ray which hits any receiver is instead kept during the field pass,
+    /// so nothing is traced twice. This is faster when there are many
+    /// receivers, but needs memory for the rays during the field pass. CPU
+    /// only; ignored in CUDA builds.
+    bool singlePassEigenrays = false;
+    /// Hexahedral (3D) SSPs are normally interpolated directly from the eight
+    /// corners of the current cell on every evaluation. If true, the
+    /// coefficients of the trilinear interpolation are precomputed for every
+    /// cell during preprocessing, which makes SSP evaluation cheaper but needs
+    /// about eight times the memory of the SSP itself. Results may differ in
+    /// the last few bits due to the different order of operations.
+    bool precomputeHexSSP = false;
+    /// Arrivals runs: order of the arrivals for each receiver. 0 leaves them in
+    /// the order they were found (ray order). 'd' sorts them by increasing
+    /// delay (real part), and 'a' by decreasing amplitude; arrivals with equal
+    /// keys stay in ray order. Sorting is done in parallel in post-processing.
+    char sortArrivals = 0;
+    /// Ray and eigenray runs: if true, bhc::writeout writes the .ray file in a
+    /// native-endian binary format instead of the BELLHOP text format. It holds
+    /// the same data (header, and SrcDeclAngle, Nsteps, NumTopBnc, NumBotBnc,
+    /// and the points of each ray) and is much faster to write and read.
+    /// bhc::readout detects which format a .ray file is in. The binary format
+    /// is not readable by BELLHOP's plotting tools.
+    bool binaryRayFile = false;
+    /// Arrivals runs: if true, bhc::writeout writes the .arr file in a
+    /// native-endian bulk format instead of the BELLHOP ascii or binary
+    /// format. All the arrival counts are stored together, followed by the
+    /// arrivals of each receiver as contiguous raw Arrival records (phase in
+    /// radians), so both the writer and the reader move data in large blocks.
+    /// bhc::readout detects which format an .arr file is in. The bulk format
+    /// is not readable by BELLHOP's plotting tools.
+    bool bulkArrivalsFile = false;
+    /// TL runs: if true, the TL field is not allocated in memory, but is the
+    /// .shd file itself, memory-mapped and laid out in .shd record order. The
+    /// trace accumulates directly into the file, the OS pages the field in and
+    /// out so it may be larger than RAM, and it does not count towards
+    /// maxMemory. The file is created (replacing any previous one) in bhc::run,
+    /// and is complete when the run is; bhc::writeout only flushes it to disk,
+    /// or copies it if writing out to a different FileRoot. Requires FileRoot
+    /// (an environment file). Multithreaded runs add to the field with atomics
+    /// instead of using per-thread copies of it. See bhcOutputs::uAllSources
+    /// for the layout. CPU only; ignored in CUDA builds.
+    bool mappedTLFile = false;
+    /// TL and arrivals runs: if true, the rays are traced once and kept in
+    /// bhcOutputs::rayinfo (the ray fan), and the influence is applied to the
+    /// receivers from the stored rays. Later runs with the same params and
+    /// outputs in which only the receivers (Pos->Rz, Rr, theta) or the run
+    /// type have changed reuse the fan instead of tracing the rays again, so
+    /// many receiver grids can be evaluated for the cost of one trace. Any
+    /// other change traces a new fan. The fan uses up to half of the memory
+    /// left after the run's own allocations; rays which do not fit are traced
+    /// in every run as usual. Not used for runs which also compute eigenrays.
+    /// CPU only; ignored in CUDA builds.
+    bool reuseRayFan = false;
+    /// TL runs: if true and the environment has more than one frequency
+    /// (freqinfo->Nfreq > 1, e.g. the 'B' broadband option), each ray is traced
+    /// once and the field is computed for every frequency in freqVec. The rays,
+    /// their amplitudes, and the boundary reflection coefficients are computed
+    /// at freq0; only the phase and the attenuation change with frequency. The
+    /// attenuation is scaled linearly from its value at freq0, so only the
+    /// attenuation units which are linear in frequency (F, W, Q, L) without
+    /// volume attenuation are supported. Cerveny beams are not supported, as
+    /// the beams depend on the frequency; geometric and simple Gaussian (SGB)
+    /// beams are. The .shd file then has a set of data records for each
+    /// frequency; bhc::readout of such a file needs this set as well. If false
+    /// (default), the field is only computed at freq0, as in BELLHOP(3D),
+    /// which only writes freqVec into the .shd header.
+    bool broadbandTL = false;
+    /// If false, bhc::run returns as soon as preprocessing is done, and the
+    /// run and post-processing continue in the background for every run type.
+    /// Use bhc::get_percent_progress to monitor it and completedCallback to be
+    /// told when it is done. params and outputs must not be touched until then,
+    /// except through get_percent_progress; the next bhc::run, bhc::writeout,
+    /// or bhc::finalize waits for the background run to complete.
+    bool blocking = true;
     /// Index of the GPU to use (ignored if not in CUDA mode). This is the order
     /// the GPUs are enumerated in CUDA, usually with the most powerful GPU
     /// as index 0.
@@ -537,9 +727,40 @@ struct bhcInit {
     /// See documentation for prtCallback above.
     void (*outputCallback)(const char *message) = nullptr;
 
-    /// Called after all the threads have completed.
-    /// Probably only useful in non-blocking mode.
+    /// Called at the end of every bhc::run, after the run and post-processing
+    /// have completed (or failed). Probably only useful in non-blocking mode
+    /// (see blocking); it is then called from a background thread, and must not
+    /// call back into this instance.
     void (*completedCallback)() = nullptr;
+
+    /**
+     * Streaming results: if set, these are called with each result as soon as
+     * it is complete, so that consumers can work in parallel with the rest of
+     * the run rather than waiting for bhc::run to return. They are called from
+     * the worker threads, in parallel and in no particular order, so they must
+     * be thread-safe, and must not call back into this instance. The data
+     * passed is only valid until the callback returns.
+     *
+     * rayCallback: ray runs: each ray, as soon as it has been traced. Eigenray
+     * runs (including arrivals + eigenrays): each eigenray. result points to a
+     * RayResult<O3D, R3D> of this instance's dimensionality, and index is the
+     * index of the ray in outputs.rayinfo->results.
+     *
+     * arrivalsCallback: arrivals runs: each receiver's arrivals, after they
+     * have been scaled, merged, and sorted in post-processing. receiver is the
+     * receiver's index in ArrInfo::NArr, i.e.
+     * [isz][isx][isy][itheta][irz][ir].
+     */
+    void (*rayCallback)(int32_t index, const void *result) = nullptr;
+    /// See documentation for rayCallback above.
+    void (*arrivalsCallback)(size_t receiver, const Arrival *arr, int32_t narr)
+        = nullptr;
+    /// If false and rayCallback is set, ray and (re-traced) eigenray runs do not
+    /// keep the rays after passing them to rayCallback. Each ray is traced into
+    /// a per-thread buffer which is reused for the next ray, so the run only
+    /// needs memory for one ray per thread. The rays in outputs.rayinfo are
+    /// then all null, and bhc::writeout writes a .ray file with no rays.
+    bool keepStreamedRays = true;
 };
 
 template<bool O3D> struct bhcParams {
@@ -561,6 +782,12 @@ template<bool O3D> struct bhcParams {
 
 template<bool O3D, bool R3D> struct bhcOutputs {
     RayInfo<O3D, R3D> *rayinfo;
+    /// TL field, indexed [ifreq][isz][isx][isy][itheta][irz][ir], with
+    /// freqinfo->NfreqTL frequencies (see bhcInit::broadbandTL).
+    /// If Pos->TLRecCpxf is nonzero (bhcInit::mappedTLFile), this is instead
+    /// the whole .shd file: the values for [isx][isy][ifreq][itheta][isz][irz]
+    /// are the first NRr values of each record of Pos->TLRecCpxf values,
+    /// after 10 header records.
     cpxf *uAllSources;
     EigenInfo *eigen;
     ArrInfo *arrinfo;
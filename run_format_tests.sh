@@ -0,0 +1,107 @@
+#!/bin/bash
+# bellhopcxx / bellhopcuda - C++/CUDA port of BELLHOP underwater acoustics simulator
+# Copyright (C) 2021-2023 The Regents of the University of California
+# c/o Jules Jaffe team at SIO / UCSD, jjaffe@ucsd.edu
+# Based on BELLHOP, which is Copyright (C) 1983-2020 Michael B. Porter
+# 
+# This program is free software: you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free Software
+# Foundation, either version 3 of the License, or (at your option) any later
+# version.
+# 
+# This program is distributed in the hope that it will be useful, but WITHOUT ANY
+# WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+# PARTICULAR PURPOSE. See the GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License along with
+# this program. If not, see <https://www.gnu.org/licenses/>.
+
+# Runs each environment writing the output file in the normal format and in
+# the bhcxx-specific binary format, reads the binary one back with the readout
+# example and writes it out in the normal format, and checks that it is the
+# same as the one written directly.
+
+#set -x
+
+memopt="--mem=18G"
+
+if [[ -z $1 || -z $2 ]]; then
+    echo "Usage: ./run_format_tests.sh (ray/eigen/arr)(2D/3D/Nx2D) tests_list"
+    exit 1
+fi
+
+if [[ $1 == *Nx2D ]]; then
+    threedopt="-4"
+elif [[ $1 == *3D ]]; then
+    threedopt="-3"
+elif [[ $1 == *2D ]]; then
+    threedopt="-2"
+else
+    echo "$1 is not a valid run type (must end with 2D/3D/Nx2D)"
+    exit 1
+fi
+runtype=`echo $1 | sed 's/Nx2D//g' | sed 's/3D//g' | sed 's/2D//g'`
+if [[ $runtype == "ray" || $runtype == "eigen" ]]; then
+    ext=ray
+    binopt="-binray"
+elif [[ $runtype == "arr" ]]; then
+    ext=arr
+    binopt="-bulkarr"
+else
+    echo "$1 is not a valid run type (must start with ray/eigen/arr)"
+    exit 1
+fi
+
+if [[ $2 == *.txt ]]; then
+    echo "BELLHOP syntax prohibits including the file extension on input files (drop the .txt)"
+    exit 1
+fi
+
+dotexe=""
+if [ -f ./bin/bellhopcxx.exe ]; then
+    dotexe=".exe"
+fi
+
+compare_results () {
+    if [[ $ext == "arr" ]]; then
+        # The arrivals are stored as-is, so the round trip is exact.
+        cmp $1 $2
+    else
+        # Nx2D rays are converted back from ocean coordinates, which may change
+        # the last digit of some points.
+        python3 compare_ray_direct.py $1 $2
+    fi
+}
+
+run_test () {
+    echo ""
+    echo $1
+    if [ ! -f "test/in/$1.env" ]; then
+        echo "test/in/$1.env does not exist"
+        exit 1
+    fi
+    for dir in cxxtext cxxbin; do
+        mkdir -p test/$dir
+        rm -f test/$dir/$1.* test/$dir/$1_readout.*
+        cp test/in/$1.* test/$dir/
+    done
+    ./bin/bellhopcxx$dotexe -1 $threedopt $memopt test/cxxtext/$1 || exit 1
+    ./bin/bellhopcxx$dotexe -1 $binopt $threedopt $memopt test/cxxbin/$1 || exit 1
+    ./bin/readout$dotexe $threedopt test/cxxbin/$1 test/cxxbin/$1_readout || exit 1
+    if ! compare_results test/cxxtext/$1.$ext test/cxxbin/$1_readout.$ext; then
+        echo "$1: $ext file read back from $binopt output differs"
+        exit 1
+    fi
+}
+
+while read -u 10 line || [[ -n $line ]]; do
+    if [[ $line == //* ]]; then
+        continue
+    fi
+    run_test $line
+done 10<$2.txt
+
+echo ""
+echo "============================="
+echo "All tests passed successfully"
+echo "============================="
@@ -122,7 +122,7 @@ compare_results () {
     elif [[ $nocompare == "1" ]]; then
         echo "Not comparing results because 'nocompare' specified"
         return 0
-    elif [[ $runtype == "arr" && ( $dir == "cxxmulti" || $dir == "cuda" ) ]]; then
+    elif [[ $runtype == "arr" && $dir == "cuda" ]]; then
         echo "Skipping $runtype results comparison for $dir"
         return 0
     fi
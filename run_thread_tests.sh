@@ -0,0 +1,91 @@
+#!/bin/bash
+# bellhopcxx / bellhopcuda - C++/CUDA port of BELLHOP underwater acoustics simulator
+# Copyright (C) 2021-2023 The Regents of the University of California
+# c/o Jules Jaffe team at SIO / UCSD, jjaffe@ucsd.edu
+# Based on BELLHOP, which is Copyright (C) 1983-2020 Michael B. Porter
+# 
+# This program is free software: you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free Software
+# Foundation, either version 3 of the License, or (at your option) any later
+# version.
+# 
+# This program is distributed in the hope that it will be useful, but WITHOUT ANY
+# WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+# PARTICULAR PURPOSE. See the GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License along with
+# this program. If not, see <https://www.gnu.org/licenses/>.
+
+# Runs each environment single-threaded and multi-threaded, and checks that the
+# output files are identical, bit for bit.
+
+#set -x
+
+memopt="--mem=18G"
+
+if [[ -z $1 || -z $2 ]]; then
+    echo "Usage: ./run_thread_tests.sh (tl/arr)(2D/3D/Nx2D) tests_list"
+    exit 1
+fi
+
+if [[ $1 == *Nx2D ]]; then
+    threedopt="-4"
+elif [[ $1 == *3D ]]; then
+    threedopt="-3"
+elif [[ $1 == *2D ]]; then
+    threedopt="-2"
+else
+    echo "$1 is not a valid run type (must end with 2D/3D/Nx2D)"
+    exit 1
+fi
+runtype=`echo $1 | sed 's/Nx2D//g' | sed 's/3D//g' | sed 's/2D//g'`
+if [[ $runtype == "tl" ]]; then
+    ext=shd
+elif [[ $runtype == "arr" ]]; then
+    ext=arr
+else
+    echo "$1 is not a valid run type (must start with tl/arr)"
+    exit 1
+fi
+
+if [[ $2 == *.txt ]]; then
+    echo "BELLHOP syntax prohibits including the file extension on input files (drop the .txt)"
+    exit 1
+fi
+
+dotexe=""
+if [ -f ./bin/bellhopcxx.exe ]; then
+    dotexe=".exe"
+fi
+
+run_test () {
+    echo ""
+    echo $1
+    if [ ! -f "test/in/$1.env" ]; then
+        echo "test/in/$1.env does not exist"
+        exit 1
+    fi
+    for dir in cxx1 cxxmulti; do
+        mkdir -p test/$dir
+        rm -f test/$dir/$1.*
+        cp test/in/$1.* test/$dir/
+    done
+    ./bin/bellhopcxx$dotexe -1 $threedopt $memopt test/cxx1/$1 || exit 1
+    ./bin/bellhopcxx$dotexe $threedopt $memopt test/cxxmulti/$1 || exit 1
+    if ! cmp test/cxx1/$1.$ext test/cxxmulti/$1.$ext; then
+        echo "$1: single-threaded and multi-threaded results differ"
+        exit 1
+    fi
+}
+
+while read -u 10 line || [[ -n $line ]]; do
+    if [[ $line == //* ]]; then
+        continue
+    fi
+    run_test $line
+done 10<$2.txt
+
+echo ""
+echo "============================="
+echo "All tests passed successfully"
+echo "============================="
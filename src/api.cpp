@@ -206,6 +206,16 @@ template<bool O3D, bool R3D> bool setup(
                 "ask " BHC_PROGRAMNAME " to limit itself to",
                 GetInternal(params)->maxMemory);
         }
+        char sortArrivals = GetInternal(params)->sortArrivals;
+        if(sortArrivals != 0 && sortArrivals != 'd' && sortArrivals != 'a') {
+            EXTERR("Invalid bhcInit::sortArrivals %c", sortArrivals);
+        }
+#ifndef BHC_BUILD_CUDA
+        if(GetInternal(params)->mappedTLFile && GetInternal(params)->noEnvFil) {
+            // LP: The .shd file is created at FileRoot during the run.
+            EXTERR("bhcInit::mappedTLFile requires an environment file (FileRoot)");
+        }
+#endif
 #ifdef BHC_BUILD_CUDA
         setupGPU(params);
 #endif
@@ -381,37 +391,165 @@ template<bool O3D, bool R3D> inline mode::ModeModule<O3D, R3D> *GetMode(
     }
 }
 
-template<bool O3D, bool R3D> bool run(
-    bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs)
+/**
+ * The part of run() after preprocessing, which continues in the background in
+ * non-blocking runs. Takes ownership of mo.
+ */
+template<bool O3D, bool R3D> bool RunAndPostprocess(
+    bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs,
+    mode::ModeModule<O3D, R3D> *mo)
 {
+    bool ret = true;
     try {
         Stopwatch sw(GetInternal(params));
-
-        sw.tick();
-        module::ModulesList<O3D> modules;
-        for(auto *m : modules.list()) m->Validate(params);
-        for(auto *m : modules.list()) m->Preprocess(params);
-        auto *mo = GetMode<O3D, R3D>(params);
-        mo->Preprocess(params, outputs);
-        sw.tock("Preprocess");
-
+        Progress &progress = GetInternal(params)->progress;
+        // LP: The workers stop on their own if cancelled while they are
+        // running; this covers the gaps between the phases.
+        auto checkCancelled = [&]() {
+            if(GetInternal(params)->cancelled) EXTERR("Run cancelled by bhc::cancel");
+        };
         sw.tick();
+        checkCancelled();
+        progress.Phase(
+            ProgressRunBase, ProgressPostBase - ProgressRunBase,
+            GetNumJobs<O3D>(params.Pos, params.Angles));
         mo->Run(params, outputs);
         sw.tock("Run");
 
         sw.tick();
-        mo->Postprocess(params, outputs);
+        checkCancelled();
         if(IsAlsoEigenraysRun(params.Beam)) {
+            int32_t half = (100 - ProgressPostBase) / 2;
+            progress.Phase(ProgressPostBase, half);
+            mo->Postprocess(params, outputs);
+            progress.Phase(ProgressPostBase + half, 100 - ProgressPostBase - half);
             mode::PostProcessEigenrays(params, outputs);
+        } else {
+            progress.Phase(ProgressPostBase, 100 - ProgressPostBase);
+            mo->Postprocess(params, outputs);
         }
         sw.tock("Postprocess");
+        progress.Finish();
+    } catch(const std::exception &e) {
+        EXTWARN("Exception caught in bhc::run(): %s\n", e.what());
+        ret = false;
+    }
+    delete mo;
 
-        delete mo;
+    if(GetInternal(params)->completedCallback != nullptr) {
+        GetInternal(params)->completedCallback();
+    }
+    return ret;
+}
+
+/**
+ * Hash of the preprocessed environment the rays are traced in, i.e. everything
+ * except the receivers and the run type (TL or arrivals), which identifies a
+ * ray fan (see bhcInit::reuseRayFan). Modules with a Hash (SSP, boundaries,
+ * reflection coefficients, source beam pattern) are only represented by
+ * envGeneration.
+ */
+template<bool O3D> inline uint64_t RayFanKey(const bhcParams<O3D> &params)
+{
+    ParamsHash h;
+    h.Add(GetInternal(params)->envGeneration);
+    for(const HSInfo *hs : {&params.Bdry->Top.hs, &params.Bdry->Bot.hs}) {
+        h.Add(hs->alphaR);
+        h.Add(hs->betaR);
+        h.Add(hs->alphaI);
+        h.Add(hs->betaI);
+        h.Add(hs->cP);
+        h.Add(hs->cS);
+        h.Add(hs->rho);
+        h.Add(hs->Depth);
+        h.Add(hs->bc);
+        h.AddArray(hs->Opt, 6);
+    }
+    h.Add(params.ssp->Type);
+    h.AddArray(params.ssp->AttenUnit, 2);
+    h.Add(params.freqinfo->freq0);
+    h.AddArray(params.Pos->Sx, params.Pos->NSx);
+    h.AddArray(params.Pos->Sy, params.Pos->NSy);
+    h.AddArray(params.Pos->Sz, params.Pos->NSz);
+    // LP: After preprocessing, as the number of beams may depend on the
+    // receiver ranges.
+    for(const AngleInfo *a : {&params.Angles->alpha, &params.Angles->beta}) {
+        h.Add(a->iSingle);
+        h.AddArray(a->angles, a->n);
+    }
+    const BeamStructure<O3D> *Beam = params.Beam;
+    h.Add(Beam->Component);
+    h.AddArray(Beam->Type, 4);
+    // LP: The influence type changes the ray, see RayInit.
+    h.Add(Beam->RunType[1]);
+    h.Add(Beam->RunType[2]);
+    h.Add(Beam->RunType[3]);
+    h.Add(Beam->RunType[5]);
+    h.Add(Beam->RunType[6]);
+    h.Add(Beam->deltas);
+    h.Add(Beam->epsMultiplier);
+    h.Add(Beam->rLoop);
+    h.Add(Beam->Box);
+    return h.Value();
+}
+
+template<bool O3D, bool R3D> bool run(
+    bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs)
+{
+    mode::ModeModule<O3D, R3D> *mo = nullptr;
+    try {
+        Stopwatch sw(GetInternal(params));
+        // Previous non-blocking run must complete before its data is changed.
+        GetInternal(params)->WaitRun();
+        GetInternal(params)->cancelled = false;
+        GetInternal(params)->progress.Phase(0, ProgressRunBase);
+
+        sw.tick();
+        module::ModulesList<O3D> modules;
+        const auto &list              = modules.list();
+        std::vector<uint64_t> &hashes = GetInternal(params)->moduleHashes;
+        // LP: Skip modules whose inputs are the same as after the last run.
+        std::vector<bool> unchanged(list.size());
+        for(size_t i = 0; i < list.size(); ++i) {
+            ParamsHash h;
+            bool hashable = list[i]->Hash(params, h);
+            unchanged[i]  = hashable && i < hashes.size() && hashes[i] == h.Value();
+            if(hashable && !unchanged[i]) ++GetInternal(params)->envGeneration;
+        }
+        hashes.clear(); // In case of an error partway through preprocessing
+        for(size_t i = 0; i < list.size(); ++i) {
+            if(!unchanged[i]) list[i]->Validate(params);
+        }
+        for(size_t i = 0; i < list.size(); ++i) {
+            if(!unchanged[i]) list[i]->Preprocess(params);
+        }
+        for(auto *m : list) {
+            ParamsHash h;
+            hashes.push_back(m->Hash(params, h) ? h.Value() : 0);
+        }
+        GetInternal(params)->rayFanKey = RayFanKey(params);
+        mo = GetMode<O3D, R3D>(params);
+        mo->Preprocess(params, outputs);
+        sw.tock("Preprocess");
     } catch(const std::exception &e) {
         EXTWARN("Exception caught in bhc::run(): %s\n", e.what());
+        delete mo;
         return false;
     }
 
+    // LP: RayInfo::blocking is the older, ray-only version of bhcInit::blocking.
+    if(GetInternal(params)->blocking
+       && (!IsRayRun(params.Beam) || outputs.rayinfo->blocking)) {
+        return RunAndPostprocess<O3D, R3D>(params, outputs, mo);
+    }
+    // LP: params and outputs are owned by the caller and must remain valid
+    // until the run completes.
+    bhcParams<O3D> *p       = &params;
+    bhcOutputs<O3D, R3D> *o = &outputs;
+    GetInternal(params)->runThread = std::thread([p, o, mo]() {
+        SetupThread();
+        RunAndPostprocess<O3D, R3D>(*p, *o, mo);
+    });
     return true;
 }
 
@@ -434,14 +572,22 @@ template<bool O3D, bool R3D> bool writeout(
 {
     try {
         Stopwatch sw(GetInternal(params));
+        GetInternal(params)->WaitRun();
+        Progress &progress = GetInternal(params)->progress;
         sw.tick();
         if(FileRoot != nullptr) { GetInternal(params)->FileRoot = FileRoot; }
         auto *mo = GetMode<O3D, R3D>(params);
-        mo->Writeout(params, outputs);
         if(IsAlsoEigenraysRun(params.Beam)) {
+            progress.Phase(0, 50);
+            mo->Writeout(params, outputs);
+            progress.Phase(50, 50);
             mode::Eigen<O3D, R3D> E1;
             E1.Writeout(params, outputs);
+        } else {
+            progress.Phase(0, 100);
+            mo->Writeout(params, outputs);
         }
+        progress.Finish();
         sw.tock("writeout");
         delete mo;
     } catch(const std::exception &e) {
@@ -471,6 +617,7 @@ template<bool O3D, bool R3D> bool readout(
     bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs, const char *FileRoot)
 {
     try {
+        GetInternal(params)->WaitRun();
         if(FileRoot == nullptr) { FileRoot = GetInternal(params)->FileRoot.c_str(); }
         auto *mo = GetMode<O3D, R3D>(params);
         mo->Readout(params, outputs, FileRoot);
@@ -502,6 +649,8 @@ template BHC_API bool readout<true, true>(
 template<bool O3D, bool R3D> void finalize(
     bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs)
 {
+    GetInternal(params)->WaitRun();
+
     module::ModulesList<O3D> modules;
     mode::ModesList<O3D, R3D> modes;
     for(auto *m : modules.list()) m->Finalize(params);
@@ -709,6 +858,18 @@ template BHC_API void extsetup_brc<false>(bhcParams<false> &params, int32_t NPts
 template BHC_API void extsetup_brc<true>(bhcParams<true> &params, int32_t NPts);
 #endif
 
+template<bool O3D> void extsetup_ssp(bhcParams<O3D> &params, int32_t NPts)
+{
+    module::SSP<O3D> pm;
+    pm.ExtSetup(params, NPts);
+}
+#if BHC_ENABLE_2D
+template BHC_API void extsetup_ssp<false>(bhcParams<false> &params, int32_t NPts);
+#endif
+#if BHC_ENABLE_3D || BHC_ENABLE_NX2D
+template BHC_API void extsetup_ssp<true>(bhcParams<true> &params, int32_t NPts);
+#endif
+
 #if BHC_ENABLE_2D
 extern BHC_API void extsetup_ssp_quad(bhcParams<false> &params, int32_t NPts, int32_t Nr)
 {
@@ -725,12 +886,22 @@ extern BHC_API void extsetup_ssp_hexahedral(
 }
 #endif
 
+template<bool O3D> void cancel(bhcParams<O3D> &params)
+{
+    GetInternal(params)->Cancel();
+}
+
+#if BHC_ENABLE_2D
+template BHC_API void cancel<false>(bhcParams<false> &params);
+#endif
+#if BHC_ENABLE_NX2D || BHC_ENABLE_3D
+template BHC_API void cancel<true>(bhcParams<true> &params);
+#endif
+
 template<bool O3D> int get_percent_progress(bhcParams<O3D> &params)
 {
     try {
-        return int(
-            100.0 * double(GetInternal(params)->completedRayCount)
-            / double(GetInternal(params)->totalJobs));
+        return GetInternal(params)->progress.Percent();
     } catch(const std::exception &e) {
         EXTWARN("Exception caught in bhc::get_percent_progress(): %s\n", e.what());
         return 0;
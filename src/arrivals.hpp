@@ -38,6 +38,120 @@ template<bool R3D> HOST_DEVICE inline bool IsSecondStepOfPair(
         && STD::abs(baseArr[Nt - 1].Phase - Phase) < PhaseTol;
 }
 
+/**
+ * Merges one arrival into the arrivals for one receiver (baseArr, baseNArr).
+ * Not thread safe.
+ */
+template<bool R3D> HOST_DEVICE inline void MergeArr(
+    Arrival *baseArr, int32_t *baseNArr, int32_t MaxNArr, real Amp, real omega,
+    real Phase, cpx delay, float SrcDeclAngle, float SrcAzimAngle, float RcvrDeclAngle,
+    float RcvrAzimAngle, int32_t NumTopBnc, int32_t NumBotBnc)
+{
+    // LP: BUG: This only checks the last arrival, whereas the first step of the
+    // pair could have been placed in previous slots. See the Fortran version readme.
+
+    int32_t Nt = *baseNArr; // # of arrivals
+
+    if(!IsSecondStepOfPair<R3D>(omega, Phase, delay, baseArr, Nt)) {
+        int32_t iArr;
+        if(Nt >= MaxNArr) { // space not available to add an arrival?
+            // replace weakest arrival
+            iArr         = -1;
+            real weakest = Amp;
+            for(Nt = 0; Nt < MaxNArr; ++Nt) {
+                if(baseArr[Nt].a < weakest) {
+                    weakest = baseArr[Nt].a;
+                    iArr    = Nt;
+                }
+            }
+            if(iArr < 0) return; // LP: current arrival is weaker than all stored
+        } else {
+            iArr      = Nt;
+            *baseNArr = Nt + 1; // # of arrivals
+        }
+        baseArr[iArr].a             = (float)Amp;      // amplitude
+        baseArr[iArr].Phase         = (float)Phase;    // phase
+        baseArr[iArr].delay         = Cpx2Cpxf(delay); // delay time
+        baseArr[iArr].SrcDeclAngle  = SrcDeclAngle;    // launch angle from source
+        baseArr[iArr].SrcAzimAngle  = SrcAzimAngle;    // launch angle from source
+        baseArr[iArr].RcvrDeclAngle = RcvrDeclAngle;   // angle ray reaches receiver
+        baseArr[iArr].RcvrAzimAngle = RcvrAzimAngle;   // angle ray reaches receiver
+        baseArr[iArr].NTopBnc       = NumTopBnc;       // Number of top    bounces
+        baseArr[iArr].NBotBnc       = NumBotBnc;       //   "       bottom
+    } else {                                           // not a new ray
+        // PhaseArr[<base> + Nt-1] = PhaseArr[<base> + Nt-1] // LP: ???
+
+        // calculate weightings of old ray information vs. new, based on amplitude of
+        // the arrival
+        float AmpTot = baseArr[Nt - 1].a + (float)Amp;
+        float w1     = baseArr[Nt - 1].a / AmpTot;
+        float w2     = (float)Amp / AmpTot;
+
+        baseArr[Nt - 1].delay = w1 * baseArr[Nt - 1].delay
+            + w2 * Cpx2Cpxf(delay); // weighted sum
+        baseArr[Nt - 1].a             = AmpTot;
+        baseArr[Nt - 1].SrcDeclAngle  = w1 * baseArr[Nt - 1].SrcDeclAngle
+            + w2 * SrcDeclAngle;
+        baseArr[Nt - 1].SrcAzimAngle  = w1 * baseArr[Nt - 1].SrcAzimAngle
+            + w2 * SrcAzimAngle;
+        baseArr[Nt - 1].RcvrDeclAngle = w1 * baseArr[Nt - 1].RcvrDeclAngle
+            + w2 * RcvrDeclAngle;
+        baseArr[Nt - 1].RcvrAzimAngle = w1 * baseArr[Nt - 1].RcvrAzimAngle
+            + w2 * RcvrAzimAngle;
+    }
+}
+
+/**
+ * LP: One call to AddArr, recorded as-is so that it can be merged after the
+ * run (see MergeArrHits). Values which AddArr compares at full precision are
+ * kept as real.
+ */
+struct ArrHit {
+    size_t base; // LP: receiver, from GetFieldAddr
+    real Amp, Phase;
+    cpx delay;
+    float SrcDeclAngle, SrcAzimAngle, RcvrDeclAngle, RcvrAzimAngle;
+    int32_t NTopBnc, NBotBnc;
+};
+
+/**
+ * Number of hits a CPU worker buffers before writing them to its file.
+ */
+constexpr uint32_t ArrHitPageSize = 256;
+
+/**
+ * LP: The hits a CPU worker thread has recorded in multithreaded arrivals runs.
+ * They are buffered in page and written to file (bhcInternal::arrHitFiles).
+ */
+struct ArrHitCursor {
+    FILE *file;     // LP: nullptr if the hits are not recorded
+    uint64_t nHits; // LP: Hits recorded, including those in page
+    uint32_t n;     // LP: Hits in page
+    bool failed;    // LP: A write to file failed
+    ArrHit page[ArrHitPageSize];
+};
+
+inline void InitArrHitCursor(ArrHitCursor *cursor, FILE *file)
+{
+    cursor->file   = file;
+    cursor->nHits  = 0;
+    cursor->n      = 0;
+    cursor->failed = false;
+}
+
+/**
+ * Writes the buffered hits to the worker's file. Must be called when the
+ * worker is done, before PostProcessArrivals.
+ */
+inline void FlushArrHits(ArrHitCursor *cursor)
+{
+    if(cursor->file == nullptr || cursor->n == 0) return;
+    if(fwrite(cursor->page, sizeof(ArrHit), cursor->n, cursor->file) != cursor->n) {
+        cursor->failed = true;
+    }
+    cursor->n = 0;
+}
+
 /**
  * Adds the amplitude and delay for an ARRival into a matrix of same.
  * Extra logic included to keep only the strongest arrivals.
@@ -45,76 +159,42 @@ template<bool R3D> HOST_DEVICE inline bool IsSecondStepOfPair(
 template<bool R3D> HOST_DEVICE inline void AddArr(
     int32_t itheta, int32_t id, int32_t ir, real Amp, real omega, real Phase, cpx delay,
     const RayInitInfo &rinit, real RcvrDeclAngle, real RcvrAzimAngle, int32_t NumTopBnc,
-    int32_t NumBotBnc, const ArrInfo *arrinfo, const Position *Pos)
+    int32_t NumBotBnc, const ArrInfo *arrinfo, ArrHitCursor *cursor, const Position *Pos)
 {
     size_t base      = GetFieldAddr(rinit.isx, rinit.isy, rinit.isz, itheta, id, ir, Pos);
     Arrival *baseArr = &arrinfo->Arr[base * arrinfo->MaxNArr];
     int32_t *baseNArr = &arrinfo->NArr[base];
     int32_t Nt;
 
+#ifndef BHC_BUILD_CUDA
+    if(cursor != nullptr && cursor->file != nullptr) {
+        // LP: Record the hit, to be merged in ray order in PostProcessArrivals.
+        if(cursor->n >= ArrHitPageSize) FlushArrHits(cursor);
+        ArrHit &hit       = cursor->page[cursor->n++];
+        hit.base          = base;
+        hit.Amp           = Amp;
+        hit.Phase         = Phase;
+        hit.delay         = delay;
+        hit.SrcDeclAngle  = (float)rinit.SrcDeclAngle;
+        hit.SrcAzimAngle  = (float)rinit.SrcAzimAngle;
+        hit.RcvrDeclAngle = (float)RcvrDeclAngle;
+        hit.RcvrAzimAngle = (float)RcvrAzimAngle;
+        hit.NTopBnc       = NumTopBnc;
+        hit.NBotBnc       = NumBotBnc;
+        ++cursor->nHits;
+        return;
+    }
+#endif
     if(arrinfo->AllowMerging) {
-        // LP: BUG: This only checks the last arrival, whereas the first step of the
-        // pair could have been placed in previous slots. See the Fortran version readme.
-
-        Nt = *baseNArr; // # of arrivals
-
-        if(!IsSecondStepOfPair<R3D>(omega, Phase, delay, baseArr, Nt)) {
-            int32_t iArr;
-            if(Nt >= arrinfo->MaxNArr) { // space not available to add an arrival?
-                // replace weakest arrival
-                iArr         = -1;
-                real weakest = Amp;
-                for(Nt = 0; Nt < arrinfo->MaxNArr; ++Nt) {
-                    if(baseArr[Nt].a < weakest) {
-                        weakest = baseArr[Nt].a;
-                        iArr    = Nt;
-                    }
-                }
-                if(iArr < 0) return; // LP: current arrival is weaker than all stored
-            } else {
-                iArr      = Nt;
-                *baseNArr = Nt + 1; // # of arrivals
-            }
-            baseArr[iArr].a            = (float)Amp;                // amplitude
-            baseArr[iArr].Phase        = (float)Phase;              // phase
-            baseArr[iArr].delay        = Cpx2Cpxf(delay);           // delay time
-            baseArr[iArr].SrcDeclAngle = (float)rinit.SrcDeclAngle; // launch angle from
-                                                                    // source
-            baseArr[iArr].SrcAzimAngle = (float)rinit.SrcAzimAngle; // launch angle from
-                                                                    // source
-            baseArr[iArr].RcvrDeclAngle = (float)RcvrDeclAngle;     // angle ray reaches
-                                                                    // receiver
-            baseArr[iArr].RcvrAzimAngle = (float)RcvrAzimAngle;     // angle ray reaches
-                                                                    // receiver
-            baseArr[iArr].NTopBnc = NumTopBnc; // Number of top    bounces
-            baseArr[iArr].NBotBnc = NumBotBnc; //   "       bottom
-        } else {                               // not a new ray
-            // PhaseArr[<base> + Nt-1] = PhaseArr[<base> + Nt-1] // LP: ???
-
-            // calculate weightings of old ray information vs. new, based on amplitude of
-            // the arrival
-            float AmpTot = baseArr[Nt - 1].a + (float)Amp;
-            float w1     = baseArr[Nt - 1].a / AmpTot;
-            float w2     = (float)Amp / AmpTot;
-
-            baseArr[Nt - 1].delay = w1 * baseArr[Nt - 1].delay
-                + w2 * Cpx2Cpxf(delay); // weighted sum
-            baseArr[Nt - 1].a            = AmpTot;
-            baseArr[Nt - 1].SrcDeclAngle = w1 * baseArr[Nt - 1].SrcDeclAngle
-                + w2 * (float)rinit.SrcDeclAngle;
-            baseArr[Nt - 1].SrcAzimAngle = w1 * baseArr[Nt - 1].SrcAzimAngle
-                + w2 * (float)rinit.SrcAzimAngle;
-            baseArr[Nt - 1].RcvrDeclAngle = w1 * baseArr[Nt - 1].RcvrDeclAngle
-                + w2 * (float)RcvrDeclAngle;
-            baseArr[Nt - 1].RcvrAzimAngle = w1 * baseArr[Nt - 1].RcvrAzimAngle
-                + w2 * (float)RcvrAzimAngle;
-        }
-
+        MergeArr<R3D>(
+            baseArr, baseNArr, arrinfo->MaxNArr, Amp, omega, Phase, delay,
+            (float)rinit.SrcDeclAngle, (float)rinit.SrcAzimAngle, (float)RcvrDeclAngle,
+            (float)RcvrAzimAngle, NumTopBnc, NumBotBnc);
     } else {
-        // LP: For multithreading mode, some mutex scheme would be needed to
-        // guarantee correct access to previously written data, which would
-        // destroy the performance on GPU. So just write the first
-        // arrinfo->MaxNArr arrivals and give up.
+        // LP: For multithreading mode on GPU, some mutex scheme would be needed
+        // to guarantee correct access to previously written data, which would
+        // destroy the performance. So just write the first arrinfo->MaxNArr
+        // arrivals and give up.
         Nt = AtomicFetchAdd(baseNArr, 1);
         if(Nt >= arrinfo->MaxNArr) return;
         baseArr[Nt].a             = (float)Amp;                // amplitude
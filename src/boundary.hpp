@@ -54,6 +54,61 @@ HOST_DEVICE inline void CopyHSInfo(HSInfo &b, const HSInfo &a)
     b.rho = a.rho;
 }
 
+/**
+ * LP: Number of segments GetBdrySeg walks linearly from the previous segment
+ * before switching to binary search.
+ */
+constexpr int32_t BdrySegMaxWalk = 4;
+
+/**
+ * LP: Whether boundary point i (along the axis given by stride and comp)
+ * starts at or before x. If !forward, points exactly at x are considered after
+ * x, so that a ray moving backwards stays in the segment ending at x.
+ */
+template<bool O3D> HOST_DEVICE inline bool BdryPtBefore(
+    const BdryPtFull<O3D> *bd, int32_t i, int32_t stride, int32_t comp, real x,
+    bool forward)
+{
+    real c = bd[i * stride].x[comp];
+    return forward ? c <= x : c < x;
+}
+
+/**
+ * LP: Returns the largest segment index i in [-1, n-1] such that boundary point
+ * i is before x (see BdryPtBefore). The boundary points are checked for being
+ * monotonic at load time. Usually the ray has only moved by 0 or 1 segments, so
+ * this walks linearly from the previous segment iseg for a few steps, and then
+ * falls back to binary search, so long jumps (e.g. a new source or a ray
+ * crossing many small segments in one step) cost O(log n) rather than O(n).
+ */
+template<bool O3D> HOST_DEVICE inline int32_t FindBdrySeg(
+    const BdryPtFull<O3D> *bd, int32_t n, int32_t stride, int32_t comp, int32_t iseg,
+    real x, bool forward)
+{
+    for(int32_t step = 0; step < BdrySegMaxWalk; ++step) {
+        if(!BdryPtBefore<O3D>(bd, iseg, stride, comp, x, forward)) {
+            if(iseg == 0) return -1;
+            --iseg;
+        } else if(
+            iseg < n - 1 && BdryPtBefore<O3D>(bd, iseg + 1, stride, comp, x, forward)) {
+            ++iseg;
+        } else {
+            return iseg;
+        }
+    }
+    int32_t low = -1;    // Low is before x (or -1)
+    int32_t hi  = n - 1; // Hi is included
+    while(low < hi) {
+        int32_t t = (low + hi + 1) / 2; // Round up
+        if(BdryPtBefore<O3D>(bd, t, stride, comp, x, forward)) {
+            low = t;
+        } else {
+            hi = t - 1;
+        }
+    }
+    return low;
+}
+
 /**
  * Get the top or bottom segment info (index and range interval) for range, r,
  * or XY position, x
@@ -75,31 +130,10 @@ template<bool O3D> HOST_DEVICE inline void GetBdrySeg(
         int32_t ny = bdinfotb->NPts.y;
         bds.Iseg.x = bhc::min(bhc::max(bds.Iseg.x, 0), nx - 2);
         bds.Iseg.y = bhc::min(bhc::max(bds.Iseg.y, 0), ny - 2);
-        if(t.x >= FL(0.0)) {
-            while(bds.Iseg.x >= 0 && bdinfotb->bd[(bds.Iseg.x) * ny].x.x > x.x)
-                --bds.Iseg.x;
-            while(bds.Iseg.x >= 0 && bds.Iseg.x < nx - 1
-                  && bdinfotb->bd[(bds.Iseg.x + 1) * ny].x.x <= x.x)
-                ++bds.Iseg.x;
-        } else {
-            while(bds.Iseg.x < nx - 1 && bdinfotb->bd[(bds.Iseg.x + 1) * ny].x.x < x.x)
-                ++bds.Iseg.x;
-            while(bds.Iseg.x >= 0 && bds.Iseg.x < nx - 1
-                  && bdinfotb->bd[(bds.Iseg.x) * ny].x.x >= x.x)
-                --bds.Iseg.x;
-        }
-        if(t.y >= FL(0.0)) {
-            while(bds.Iseg.y >= 0 && bdinfotb->bd[bds.Iseg.y].x.y > x.y) --bds.Iseg.y;
-            while(bds.Iseg.y >= 0 && bds.Iseg.y < ny - 1
-                  && bdinfotb->bd[bds.Iseg.y + 1].x.y <= x.y)
-                ++bds.Iseg.y;
-        } else {
-            while(bds.Iseg.y < ny - 1 && bdinfotb->bd[bds.Iseg.y + 1].x.y < x.y)
-                ++bds.Iseg.y;
-            while(bds.Iseg.y >= 0 && bds.Iseg.y < ny - 1
-                  && bdinfotb->bd[bds.Iseg.y].x.y >= x.y)
-                --bds.Iseg.y;
-        }
+        bds.Iseg.x = FindBdrySeg<O3D>(
+            bdinfotb->bd, nx, ny, 0, bds.Iseg.x, x.x, t.x >= FL(0.0));
+        bds.Iseg.y = FindBdrySeg<O3D>(
+            bdinfotb->bd, ny, 1, 1, bds.Iseg.y, x.y, t.y >= FL(0.0));
 
         if(bds.Iseg.x == -1 && bdinfotb->bd[0].x.x == x.x) bds.Iseg.x = 0;
         if(bds.Iseg.x == nx - 1 && bdinfotb->bd[(nx - 1) * ny].x.x == x.x)
@@ -175,21 +209,10 @@ template<bool O3D> HOST_DEVICE inline void GetBdrySeg(
             return;
         }
 
-        // LP: bdinfotb->bd.x is checked for being monotonic at load time, so we can
-        // linearly search out from the last position, usually only have to move
-        // by 1
         int32_t n = bdinfotb->NPts;
         bds.Iseg  = bhc::min(bhc::max(bds.Iseg, 0), n - 2);
-        if(t.x >= FL(0.0)) {
-            while(bds.Iseg >= 0 && bdinfotb->bd[bds.Iseg].x.x > x.x) --bds.Iseg;
-            while(bds.Iseg >= 0 && bds.Iseg < n - 1
-                  && bdinfotb->bd[bds.Iseg + 1].x.x <= x.x)
-                ++bds.Iseg;
-        } else {
-            while(bds.Iseg < n - 1 && bdinfotb->bd[bds.Iseg + 1].x.x < x.x) ++bds.Iseg;
-            while(bds.Iseg >= 0 && bds.Iseg < n - 1 && bdinfotb->bd[bds.Iseg].x.x >= x.x)
-                --bds.Iseg;
-        }
+        bds.Iseg  = FindBdrySeg<O3D>(
+            bdinfotb->bd, n, 1, 0, bds.Iseg, x.x, t.x >= FL(0.0));
         if(bds.Iseg < 0 || bds.Iseg >= n - 1) {
             // Iseg MUST LIE IN [0, NPts-2]
             RunError(
@@ -69,9 +69,28 @@ void showhelp(const char *argv0)
            "-copy, -raycopy: Sets the behavior when there is insufficient memory to\n"
            "    allocate the requested number of full-size rays. See "
            "bhcInit::useRayCopyMode\n    in <bhc/structs.hpp> for more details\n"
+           "-singlepass, -eigensinglepass: Keep ray trajectories during the field\n"
+           "    pass of eigenray runs instead of re-tracing them. See\n"
+           "    bhcInit::singlePassEigenrays in <bhc/structs.hpp> for more details\n"
+           "-hexcoef, -precomputehexssp: Precompute per-cell interpolation\n"
+           "    coefficients for hexahedral SSPs. See bhcInit::precomputeHexSSP\n"
+           "    in <bhc/structs.hpp> for more details\n"
+           "-binray, -binaryray: Writes the .ray file in binary instead of text. See\n"
+           "    bhcInit::binaryRayFile in <bhc/structs.hpp> for more details\n"
+           "-bulkarr, -bulkarrivals: Writes the .arr file in a bulk binary format.\n"
+           "    See bhcInit::bulkArrivalsFile in <bhc/structs.hpp> for more details\n"
+           "-mmaptl, -mappedtl: Accumulates the TL field directly in the memory-mapped\n"
+           "    .shd file. See bhcInit::mappedTLFile in <bhc/structs.hpp> for more\n"
+           "    details\n"
+           "-broadband, -broadbandtl: Computes the TL field for every frequency of a\n"
+           "    broadband environment. See bhcInit::broadbandTL in <bhc/structs.hpp>\n"
+           "    for more details\n"
 #if BHC_BUILD_CUDA
            "-gpu=N, -device=N: Selects CUDA device N\n"
 #endif
+           "-sortarr=delay, -sortarr=amp: Sorts the arrivals for each receiver by\n"
+           "    increasing delay or decreasing amplitude. See bhcInit::sortArrivals\n"
+           "    in <bhc/structs.hpp> for more details\n"
            "-mem=X, -memory=X: Sets the amount of memory " BHC_PROGRAMNAME
            " should use.\n"
            "    X may have a wide range of suffixes, examples: 16GiB, 8M, 100000kB\n"
@@ -102,6 +121,18 @@ int main(int argc, char **argv)
                 dimmode = 3;
             } else if(s == "-copy" || s == "-raycopy") {
                 init.useRayCopyMode = true;
+            } else if(s == "-singlepass" || s == "-eigensinglepass") {
+                init.singlePassEigenrays = true;
+            } else if(s == "-hexcoef" || s == "-precomputehexssp") {
+                init.precomputeHexSSP = true;
+            } else if(s == "-binray" || s == "-binaryray") {
+                init.binaryRayFile = true;
+            } else if(s == "-bulkarr" || s == "-bulkarrivals") {
+                init.bulkArrivalsFile = true;
+            } else if(s == "-mmaptl" || s == "-mappedtl") {
+                init.mappedTLFile = true;
+            } else if(s == "-broadband" || s == "-broadbandtl") {
+                init.broadbandTL = true;
             } else if(s == "-?" || s == "-h" || s == "-help") {
                 showhelp(argv[0]);
                 return 0;
@@ -149,6 +180,17 @@ int main(int argc, char **argv)
                         return 1;
                     }
                     init.maxMemory = multiplier * std::stoi(value);
+                } else if(key == "-sortarr") {
+                    if(value == "delay") {
+                        init.sortArrivals = 'd';
+                    } else if(value == "amp") {
+                        init.sortArrivals = 'a';
+                    } else {
+                        std::cout << "Value \"" << value
+                                  << "\" for --sortarr argument is invalid, try "
+                                  << argv[0] << " --help\n";
+                        return 1;
+                    }
                 } else {
                     std::cout << "Unknown command-line option \"-" << key << "=" << value
                               << "\", try " << argv[0] << " --help\n";
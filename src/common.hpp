@@ -39,7 +39,13 @@ this program. If not, see <https://www.gnu.org/licenses/>.
 #include <cinttypes>
 #include <cstdarg>
 #include <chrono>
+#include <algorithm>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <vector>
 
 #define GLM_FORCE_EXPLICIT_CTOR 1
 #include <glm/common.hpp>
@@ -378,6 +384,22 @@ template<bool O3D> HOST_DEVICE inline bool GetJobIndices(
     return (rinit.isz < Pos->NSz);
 }
 
+/**
+ * Inverse of GetJobIndices.
+ */
+template<bool O3D> HOST_DEVICE inline int32_t GetJobNumber(
+    int32_t isx, int32_t isy, int32_t isz, int32_t ialpha, int32_t ibeta,
+    const Position *Pos, const AnglesStructure *Angles)
+{
+    int32_t job = isz;
+    if constexpr(O3D) {
+        job = (job * Pos->NSx + isx) * Pos->NSy + isy;
+        if(Angles->beta.iSingle == 0) job = job * Angles->beta.n + ibeta;
+    }
+    if(Angles->alpha.iSingle == 0) job = job * Angles->alpha.n + ialpha;
+    return job;
+}
+
 HOST_DEVICE inline size_t GetFieldAddr(
     int32_t isx, int32_t isy, int32_t isz, int32_t itheta, int32_t id, int32_t ir,
     const Position *Pos)
@@ -392,6 +414,39 @@ HOST_DEVICE inline size_t GetFieldAddr(
     // clang-format on
 }
 
+HOST_DEVICE inline size_t GetFieldSize(const Position *Pos)
+{
+    return (size_t)Pos->NSz * (size_t)Pos->NSx * (size_t)Pos->NSy * (size_t)Pos->Ntheta
+        * (size_t)Pos->NRz_per_range * (size_t)Pos->NRr;
+}
+
+/**
+ * LP: TL runs store one field (of GetFieldSize) per frequency, one after
+ * another; frequency is the largest index.
+ */
+HOST_DEVICE inline size_t GetTLFieldSize(const Position *Pos, const FreqInfo *freqinfo)
+{
+    return (size_t)freqinfo->NfreqTL * GetFieldSize(Pos);
+}
+
+/**
+ * LP: Record number in the .shd file of the TL values for one frequency,
+ * source, bearing, and depth. The first 10 records are the header.
+ */
+HOST_DEVICE inline size_t GetRecNum(
+    int32_t isx, int32_t isy, int32_t ifreq, int32_t itheta, int32_t isz, int32_t Irz1,
+    const Position *Pos, int32_t Nfreq)
+{
+    // clang-format off
+    return        10                     + (((((size_t)isx
+        * (size_t)Pos->NSy           + (size_t)isy)
+        * (size_t)Nfreq              + (size_t)ifreq)
+        * (size_t)Pos->Ntheta        + (size_t)itheta)
+        * (size_t)Pos->NSz           + (size_t)isz)
+        * (size_t)Pos->NRz_per_range + (size_t)Irz1;
+    // clang-format on
+}
+
 std::ostream &operator<<(std::ostream &s, const vec2 &v);
 
 } // namespace bhc
@@ -400,6 +455,10 @@ std::ostream &operator<<(std::ostream &s, const vec2 &v);
 #include "util/errors.hpp"
 #include "util/prtfileemu.hpp"
 #include "util/timing.hpp"
+#include "util/threadpool.hpp"
+#include "util/jobscheduler.hpp"
+#include "util/progress.hpp"
+#include "util/mappedfile.hpp"
 #include "runtype.hpp"
 #undef _BHC_INCLUDING_COMPONENTS_
 
@@ -409,37 +468,111 @@ namespace bhc {
 // Internal
 ////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * LP: Hits recorded by a CPU worker for one chunk of jobs, which are traced in
+ * order by that worker, in its temporary file (see MergeArrHits).
+ */
+struct ArrHitSegment {
+    int32_t firstJob, worker;
+    uint64_t firstHit, nHits;
+};
+
 struct bhcInternal {
     void (*outputCallback)(const char *message);
     void (*completedCallback)();
+    void (*rayCallback)(int32_t index, const void *result);
+    void (*arrivalsCallback)(size_t receiver, const Arrival *arr, int32_t narr);
+    bool keepStreamedRays;
     std::string FileRoot;
     PrintFileEmu PRTFile;
-    std::atomic<int32_t> sharedJobID;
     int gpuIndex, d_multiprocs; // d_warp, d_maxthreads
     int32_t numThreads;
     size_t maxMemory;
     size_t usedMemory;
     bool useRayCopyMode;
+    bool singlePassEigenrays;
+    bool precomputeHexSSP;
+    char sortArrivals;
+    bool binaryRayFile;
+    bool bulkArrivalsFile;
+    bool mappedTLFile;
+    bool reuseRayFan;
+    bool broadbandTL;
     bool noEnvFil;
     uint8_t dim;
-    std::atomic<int32_t> totalJobs;
-    std::atomic<int32_t> activeThreadCount;
-    std::atomic<int32_t> completedRayCount;
-    ErrState errState;
+    bool blocking;
+    Progress progress;
+    JobScheduler jobScheduler;
+    ThreadPool threadPool;
+    /// ParamsModule::Hash of each module after the last successful
+    /// preprocessing in run(), in ModulesList order; empty before the first.
+    std::vector<uint64_t> moduleHashes;
+    /// Incremented whenever a module with a Hash is preprocessed, as the data
+    /// it does not hash may have changed (see RayFanKey in api.cpp).
+    uint64_t envGeneration;
+    /// Identifies the environment of the current run for the ray fan; the fan
+    /// in rayinfo is reused if its fanKey matches (see bhcInit::reuseRayFan).
+    uint64_t rayFanKey;
+    /// The .shd file, when the TL field is memory-mapped (mappedTLFile).
+    MappedFile tlFile;
+    /// Multithreaded CPU arrivals runs: temporary file of hits for each
+    /// worker, and the segments of them, to be merged in job order after the
+    /// run (see MergeArrHits). Empty otherwise. Segments are added under
+    /// arrHitMutex.
+    std::vector<FILE *> arrHitFiles;
+    std::vector<ArrHitSegment> arrHitSegments;
+    std::mutex arrHitMutex;
+    /// Runs the rest of a non-blocking bhc::run after preprocessing.
+    std::thread runThread;
+    /// bhc::cancel was called during the current run.
+    std::atomic<bool> cancelled;
+    /// ErrState of the run phase currently in progress, which bhc::cancel
+    /// raises BHC_ERR_CANCELLED in to stop the workers. Protected by
+    /// cancelMutex.
+    ErrState *cancelTarget;
+    std::mutex cancelMutex;
 
     bhcInternal(const bhcInit &init, bool o3d, bool r3d)
         : outputCallback(init.outputCallback), completedCallback(init.completedCallback),
+          rayCallback(init.rayCallback), arrivalsCallback(init.arrivalsCallback),
+          keepStreamedRays(init.keepStreamedRays),
           FileRoot(
               init.FileRoot == nullptr ? "error_incorrect_use_of_" BHC_PROGRAMNAME
                                        : init.FileRoot),
           PRTFile(this, this->FileRoot, init.prtCallback), gpuIndex(init.gpuIndex),
           numThreads(ModifyNumThreads(init.numThreads)), maxMemory(init.maxMemory),
           usedMemory(0), useRayCopyMode(init.useRayCopyMode),
+          singlePassEigenrays(init.singlePassEigenrays),
+          precomputeHexSSP(init.precomputeHexSSP), sortArrivals(init.sortArrivals),
+          binaryRayFile(init.binaryRayFile), bulkArrivalsFile(init.bulkArrivalsFile),
+          mappedTLFile(init.mappedTLFile), reuseRayFan(init.reuseRayFan),
+          broadbandTL(init.broadbandTL),
           noEnvFil(init.FileRoot == nullptr), dim(r3d       ? 3
                                                       : o3d ? 4
                                                             : 2),
-          totalJobs(1), activeThreadCount(0), completedRayCount(0)
+          blocking(init.blocking), jobScheduler(numThreads), threadPool(numThreads),
+          envGeneration(0), rayFanKey(0), cancelled(false), cancelTarget(nullptr)
     {}
+
+    /// Wait for a non-blocking run (if any) to complete.
+    void WaitRun()
+    {
+        if(runThread.joinable()) runThread.join();
+        threadPool.WaitIdle();
+    }
+
+    void Cancel()
+    {
+        std::lock_guard<std::mutex> lock(cancelMutex);
+        cancelled = true;
+        if(cancelTarget != nullptr) RunError(cancelTarget, BHC_ERR_CANCELLED);
+    }
+    void SetCancelTarget(ErrState *errState)
+    {
+        std::lock_guard<std::mutex> lock(cancelMutex);
+        cancelTarget = errState;
+        if(errState != nullptr && cancelled) RunError(errState, BHC_ERR_CANCELLED);
+    }
 };
 
 template<bool O3D> inline bhcInternal *GetInternal(const bhcParams<O3D> &params)
@@ -447,4 +580,35 @@ template<bool O3D> inline bhcInternal *GetInternal(const bhcParams<O3D> &params)
     return reinterpret_cast<bhcInternal *>(params.internal);
 }
 
+/**
+ * Whether this run traces its rays into a ray fan, or reuses the one from an
+ * earlier run (see bhcInit::reuseRayFan).
+ */
+template<bool O3D> inline bool UseRayFan(const bhcParams<O3D> &params)
+{
+#ifdef BHC_BUILD_CUDA
+    return false;
+#else
+    return GetInternal(params)->reuseRayFan
+        && (IsTLRun(params.Beam) || IsArrivalsRun(params.Beam))
+        && !IsAlsoEigenraysRun(params.Beam);
+#endif
+}
+
+/**
+ * While this exists, bhc::cancel stops the workers using errState, by raising
+ * BHC_ERR_CANCELLED in it (which they check between rays and at every step).
+ */
+class CancelScope {
+public:
+    CancelScope(bhcInternal *internal_, ErrState *errState) : internal(internal_)
+    {
+        internal->SetCancelTarget(errState);
+    }
+    ~CancelScope() { internal->SetCancelTarget(nullptr); }
+
+private:
+    bhcInternal *internal;
+};
+
 } // namespace bhc
@@ -36,7 +36,7 @@ namespace bhc {
 // String manipulation
 ////////////////////////////////////////////////////////////////////////////////
 
-inline bool isInt(std::string str, bool allowNegative = true)
+inline bool isInt(const std::string &str, bool allowNegative = true)
 {
     if(str.empty()) return false;
     for(size_t i = 0; i < str.length(); ++i) {
@@ -52,7 +52,7 @@ inline bool isInt(std::string str, bool allowNegative = true)
     return true;
 }
 
-inline bool isReal(std::string str)
+inline bool isReal(const std::string &str)
 {
     if(str.empty()) return false;
     char *ptr;
@@ -138,6 +138,7 @@ inline bool endswith(const std::string &source, const std::string &target)
 #include "util/ldio.hpp"
 #include "util/directio.hpp"
 #include "util/unformattedio.hpp"
+#include "util/paramshash.hpp"
 #undef _BHC_INCLUDING_COMPONENTS_
 
 namespace bhc {
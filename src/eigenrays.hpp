@@ -21,11 +21,14 @@ this program. If not, see <https://www.gnu.org/licenses/>.
 
 namespace bhc {
 
-HOST_DEVICE inline void RecordEigenHit(
-    int32_t itheta, int32_t ir, int32_t iz, int32_t is, const RayInitInfo &rinit,
+template<bool R3D> HOST_DEVICE inline void RecordEigenHit(
+    int32_t itheta, int32_t ir, int32_t iz, int32_t is, InfluenceRayInfo<R3D> &inflray,
     EigenInfo *eigen)
 {
-    int32_t mi = AtomicFetchAdd(&eigen->neigen, 1);
+    const RayInitInfo &rinit = inflray.init;
+    int32_t Nsteps           = is + inflray.eigenStepPoints;
+    inflray.eigenMaxPoints   = bhc::max(inflray.eigenMaxPoints, Nsteps);
+    int32_t mi               = AtomicFetchAdd(&eigen->neigen, 1);
     if(mi >= eigen->memsize) return;
     // printf("Eigenray hit %d ir %d iz %d isrc %d ialpha %d is %d\n",
     //     mi, ir, iz, isrc, ialpha, is);
@@ -38,6 +41,29 @@ HOST_DEVICE inline void RecordEigenHit(
     eigen->hits[mi].isz    = rinit.isz;
     eigen->hits[mi].ialpha = rinit.ialpha;
     eigen->hits[mi].ibeta  = rinit.ibeta;
+    eigen->hits[mi].Nsteps = Nsteps;
+}
+
+/**
+ * Single-pass eigenrays: copies the part of the ray the hits need (see
+ * MainFieldModes) into the ray memory, as the result for this job.
+ */
+template<bool O3D, bool R3D> inline void StoreEigenRay(
+    RayInfo<O3D, R3D> *rayinfo, int32_t job, const RayResult<O3D, R3D> &eigenRay,
+    ErrState *errState)
+{
+    RayResult<O3D, R3D> *res = &rayinfo->results[job];
+    size_t p = AtomicFetchAdd(&rayinfo->RayMemPoints, (size_t)eigenRay.Nsteps);
+    if(p + (size_t)eigenRay.Nsteps > rayinfo->RayMemCapacity) {
+        RunWarning(errState, BHC_WARN_RAYS_OUTOFMEMORY);
+        res->ray = nullptr;
+        return;
+    }
+    res->ray = &rayinfo->RayMem[p];
+    memcpy(res->ray, eigenRay.ray, eigenRay.Nsteps * sizeof(rayPt<R3D>));
+    res->org          = eigenRay.org;
+    res->SrcDeclAngle = eigenRay.SrcDeclAngle;
+    res->Nsteps       = eigenRay.Nsteps;
 }
 
 } // namespace bhc
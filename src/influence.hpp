@@ -421,54 +421,81 @@ template<bool R3D> HOST_DEVICE inline real FinalPhase(
 ////////////////////////////////////////////////////////////////////////////////
 
 template<bool R3D> HOST_DEVICE inline void AddToField(
-    cpxf *uAllSources, const cpxf &dfield, int32_t itheta, int32_t ir, int32_t iz,
-    const InfluenceRayInfo<R3D> &inflray, const Position *Pos)
+    cpxf *uAllSources, const cpxf &dfield, int32_t ifreq, int32_t itheta, int32_t ir,
+    int32_t iz, const InfluenceRayInfo<R3D> &inflray, const Position *Pos)
 {
-    size_t base = GetFieldAddr(
-        inflray.init.isx, inflray.init.isy, inflray.init.isz, itheta, iz, ir, Pos);
-    AtomicAddCpx(&uAllSources[base], dfield);
+    const RayInitInfo &rinit = inflray.init;
+    size_t base;
+    if(Pos->TLRecCpxf == 0) {
+        base = (size_t)ifreq * inflray.fieldSize
+            + GetFieldAddr(rinit.isx, rinit.isy, rinit.isz, itheta, iz, ir, Pos);
+    } else {
+        // LP: uAllSources is the mapped .shd file (see bhcOutputs::uAllSources)
+        size_t rec = GetRecNum(
+            rinit.isx, rinit.isy, ifreq, itheta, rinit.isz, iz, Pos, inflray.Nfreq);
+        base = rec * (size_t)Pos->TLRecCpxf + (size_t)ir;
+    }
+    if(inflray.uPrivate) {
+        uAllSources[base] += dfield;
+    } else {
+        AtomicAddCpx(&uAllSources[base], dfield);
+    }
 }
 
 template<typename CFG, bool O3D, bool R3D> HOST_DEVICE inline void ApplyContribution(
     cpxf *uAllSources, real cnst, real w, real omega, cpx delay, real phaseInt,
     real RcvrDeclAngle, real RcvrAzimAngle, int32_t itheta, int32_t ir, int32_t iz,
-    int32_t is, const InfluenceRayInfo<R3D> &inflray, const rayPt<R3D> &point1,
+    int32_t is, InfluenceRayInfo<R3D> &inflray, const rayPt<R3D> &point1,
     const Position *Pos, const BeamStructure<O3D> *Beam, EigenInfo *eigen,
     const ArrInfo *arrinfo)
 {
     if constexpr(O3D && !R3D) { itheta = inflray.init.ibeta; }
     if constexpr(CFG::run::IsEigenrays()) {
         // eigenrays
-        RecordEigenHit(itheta, ir, iz, is, inflray.init, eigen);
+        RecordEigenHit(itheta, ir, iz, is, inflray, eigen);
     } else if constexpr(CFG::run::IsArrivals()) {
         // arrivals
         AddArr<R3D>(
             itheta, iz, ir, cnst * w, omega, phaseInt, delay, inflray.init, RcvrDeclAngle,
-            RcvrAzimAngle, point1.NumTopBnc, point1.NumBotBnc, arrinfo, Pos);
+            RcvrAzimAngle, point1.NumTopBnc, point1.NumBotBnc, arrinfo,
+            inflray.arrCursor, Pos);
         if(IsAlsoEigenraysRun(Beam)) {
             // TODO: check how much this if statement costs
-            RecordEigenHit(itheta, ir, iz, is, inflray.init, eigen);
+            RecordEigenHit(itheta, ir, iz, is, inflray, eigen);
         }
     } else {
-        cpxf dfield;
-        if(IsCoherentRun(Beam)) {
-            // coherent TL
-            dfield = Cpx2Cpxf(cnst * w * STD::exp(-J * (omega * delay - phaseInt)));
-            // printf("%20.17f %20.17f\n", dfield.real(), dfield.imag());
-            // omega * SQ(n) / (FL(2.0) * SQ(point1.c) * delay)))) // curvature correction
-            // [LP: 2D only]
-        } else {
-            // incoherent/semicoherent TL
-            real v = cnst * STD::exp((omega * delay).imag());
-            v      = SQ(v) * w;
-            if(IsGaussianGeomInfl(Beam)) {
-                // Gaussian beam
-                v *= GaussScaleFactor<R3D>();
+        // LP: Broadband: the ray, its amplitude, and the boundary reflection
+        // coefficients are only computed once, at freq0. Only the phase and
+        // the attenuation differ between frequencies. The attenuation is in
+        // delay.imag() as a travel time, so omegaf * delay.imag() is the
+        // attenuation at freq f only if it is linear in frequency; the other
+        // attenuation units are rejected in PreRun_Influence.
+        for(int32_t ifreq = 0; ifreq < inflray.Nfreq; ++ifreq) {
+            real omegaf = inflray.Nfreq == 1
+                ? omega
+                : FL(2.0) * REAL_PI * inflray.freqVec[ifreq];
+            cpxf dfield;
+            if(IsCoherentRun(Beam)) {
+                // coherent TL
+                dfield = Cpx2Cpxf(
+                    cnst * w * STD::exp(-J * (omegaf * delay - phaseInt)));
+                // printf("%20.17f %20.17f\n", dfield.real(), dfield.imag());
+                // omega * SQ(n) / (FL(2.0) * SQ(point1.c) * delay)))) // curvature
+                // correction [LP: 2D only]
+            } else {
+                // incoherent/semicoherent TL
+                real v = cnst * STD::exp((omegaf * delay).imag());
+                v      = SQ(v) * w;
+                if(IsGaussianGeomInfl(Beam)) {
+                    // Gaussian beam
+                    v *= GaussScaleFactor<R3D>();
+                }
+                dfield = cpxf((float)v, 0.0f);
             }
-            dfield = cpxf((float)v, 0.0f);
+            // printf("ApplyContribution dfield (%g,%g)\n", dfield.real(),
+            // dfield.imag());
+            AddToField<R3D>(uAllSources, dfield, ifreq, itheta, ir, iz, inflray, Pos);
         }
-        // printf("ApplyContribution dfield (%g,%g)\n", dfield.real(), dfield.imag());
-        AddToField<R3D>(uAllSources, dfield, itheta, ir, iz, inflray, Pos);
     }
 }
 
@@ -478,6 +505,27 @@ template<typename CFG, bool O3D, bool R3D> HOST_DEVICE inline void ApplyContribu
 
 template<bool O3D, bool R3D> inline void PreRun_Influence(bhcParams<O3D> &params)
 {
+    if(IsTLRun(params.Beam) && GetInternal(params)->broadbandTL
+       && params.freqinfo->Nfreq > 1) {
+        if(IsCervenyInfl(params.Beam)) {
+            EXTERR("Broadband TL runs (Nfreq > 1) are not supported with Cerveny "
+                   "influence, as the beams depend on the frequency");
+        }
+        if(params.ssp->AttenUnit[0] == 'N' || params.ssp->AttenUnit[0] == 'M'
+           || params.ssp->AttenUnit[1] != ' ') {
+            EXTERR("Broadband TL runs (Nfreq > 1) only support attenuation which is "
+                   "linear in frequency (units F, W, Q, or L, without volume "
+                   "attenuation), as it is scaled from its value at freq0");
+        }
+#ifdef BHC_LIMIT_FEATURES
+        EXTERR("Broadband TL runs (Nfreq > 1) are not supported by BELLHOP(3D) "
+               "but can be supported by " BHC_PROGRAMNAME " if you turn off "
+               "BHC_LIMIT_FEATURES");
+#else
+        EXTWARN("Warning: Broadband TL runs (Nfreq > 1) are not supported by "
+                "BELLHOP(3D), but are supported by " BHC_PROGRAMNAME);
+#endif
+    }
     if(IsCervenyInfl(params.Beam)) {
         if constexpr(R3D) {
             // LP: The Influence3D (Cerveny) function is commented out; was
@@ -531,11 +579,14 @@ template<typename CFG, bool O3D, bool R3D> HOST_DEVICE inline void Init_Influenc
 {
     bool isGaussian = IsGaussianGeomInfl(Beam);
 
-    inflray.init  = rinit;
-    inflray.freq0 = freqinfo->freq0;
-    inflray.omega = FL(2.0) * REAL_PI * inflray.freq0;
-    inflray.c0    = point0.c;
-    inflray.xs    = point0.x;
+    inflray.init      = rinit;
+    inflray.freq0     = freqinfo->freq0;
+    inflray.omega     = FL(2.0) * REAL_PI * inflray.freq0;
+    inflray.Nfreq     = CFG::run::IsTL() ? freqinfo->NfreqTL : 1;
+    inflray.freqVec   = freqinfo->freqVec;
+    inflray.fieldSize = GetFieldSize(Pos);
+    inflray.c0        = point0.c;
+    inflray.xs        = point0.x;
     // LP: The 5x version is changed to 50x on both codepaths before it is used.
     // inflray.RadMax = FL(5.0) * ccpx.real() / freqinfo->freq0; // 5 wavelength max
     // radius
@@ -755,9 +806,11 @@ template<typename CFG, bool O3D> HOST_DEVICE inline bool Step_InfluenceCervenyRa
                         }
                         contri *= Hermite(n, inflray.RadMax, FL(2.0) * inflray.RadMax);
 
+                        // LP: freq0 only; broadband TL is not supported with
+                        // Cerveny beams (see PreRun_Influence).
                         AddToField<false>(
-                            uAllSources, Cpx2Cpxf(contri), O3D ? inflray.init.ibeta : 0,
-                            ir, iz, inflray, Pos);
+                            uAllSources, Cpx2Cpxf(contri), 0,
+                            O3D ? inflray.init.ibeta : 0, ir, iz, inflray, Pos);
                     }
                 }
             }
@@ -877,8 +930,9 @@ template<typename CFG, bool O3D> HOST_DEVICE inline bool Step_InfluenceCervenyCa
                 if(!IsCoherentRun(Beam)) { contri = contri * STD::conj(contri); }
             }
 
+            // LP: freq0 only, see Step_InfluenceCervenyRayCen.
             AddToField<false>(
-                uAllSources, Cpx2Cpxf(contri), O3D ? inflray.init.ibeta : 0, ir, iz,
+                uAllSources, Cpx2Cpxf(contri), 0, O3D ? inflray.init.ibeta : 0, ir, iz,
                 inflray, Pos);
         }
     }
@@ -898,7 +952,7 @@ template<typename CFG, bool O3D, bool R3D> HOST_DEVICE inline void InfluenceGeoC
     real s, real n1, [[maybe_unused]] real n2, const V2M2<R3D> &dq, const cpx &dtau,
     int32_t itheta, int32_t ir, int32_t iz, int32_t is, const rayPt<R3D> &point0,
     const rayPt<R3D> &point1, real RcvrDeclAngle, real RcvrAzimAngle,
-    const InfluenceRayInfo<R3D> &inflray, cpxf *uAllSources, const Position *Pos,
+    InfluenceRayInfo<R3D> &inflray, cpxf *uAllSources, const Position *Pos,
     const BeamStructure<O3D> *Beam, EigenInfo *eigen, const ArrInfo *arrinfo)
 {
     static_assert(
@@ -18,57 +18,158 @@ this program. If not, see <https://www.gnu.org/licenses/>.
 */
 #include "arr.hpp"
 #include "../common_run.hpp"
+#include <vector>
 
 namespace bhc { namespace mode {
 
+/**
+ * LP: Seeks to a position in a file which may be larger than 2 GiB.
+ */
+inline bool SeekArrHits(FILE *file, uint64_t hit)
+{
+    uint64_t pos = hit * sizeof(ArrHit);
+#ifdef _WIN32
+    return _fseeki64(file, (int64_t)pos, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t)pos, SEEK_SET) == 0;
+#endif
+}
+
+/**
+ * Merges the hits recorded by the worker threads into Arr / NArr, in the order
+ * a single thread would have added them. Each segment is a contiguous range of
+ * jobs which one worker traced in order, so going through the segments in job
+ * order and the hits of each segment in the order they were recorded gives
+ * the same sequence of MergeArr calls, and so the same arrivals, as a
+ * single-threaded run.
+ */
+template<bool O3D, bool R3D> void MergeArrHits(
+    const bhcParams<O3D> &params, ArrInfo *arrinfo)
+{
+    bhcInternal *internal            = GetInternal(params);
+    std::vector<ArrHitSegment> &segs = internal->arrHitSegments;
+    std::sort(
+        segs.begin(), segs.end(), [](const ArrHitSegment &s1, const ArrHitSegment &s2) {
+            return s1.firstJob < s2.firstJob;
+        });
+
+    real omega = FL(2.0) * REAL_PI * params.freqinfo->freq0;
+    ArrHit page[ArrHitPageSize];
+    for(const ArrHitSegment &seg : segs) {
+        FILE *file = internal->arrHitFiles[seg.worker];
+        if(!SeekArrHits(file, seg.firstHit)) {
+            EXTERR("Could not read the arrivals back from the temporary file");
+        }
+        for(uint64_t h = 0; h < seg.nHits; h += ArrHitPageSize) {
+            size_t n = (size_t)bhc::min(seg.nHits - h, (uint64_t)ArrHitPageSize);
+            if(fread(page, sizeof(ArrHit), n, file) != n) {
+                EXTERR("Could not read the arrivals back from the temporary file");
+            }
+            for(size_t i = 0; i < n; ++i) {
+                const ArrHit &hit = page[i];
+                MergeArr<R3D>(
+                    &arrinfo->Arr[hit.base * arrinfo->MaxNArr], &arrinfo->NArr[hit.base],
+                    arrinfo->MaxNArr, hit.Amp, omega, hit.Phase, hit.delay,
+                    hit.SrcDeclAngle, hit.SrcAzimAngle, hit.RcvrDeclAngle,
+                    hit.RcvrAzimAngle, hit.NTopBnc, hit.NBotBnc);
+            }
+        }
+    }
+
+    FreeHits(params);
+}
+
+/**
+ * LP: Sorts one receiver's arrivals according to bhcInit::sortArrivals.
+ */
+inline void SortArrivals(Arrival *arr, int32_t narr, char sortMode)
+{
+    if(sortMode == 'd') {
+        std::stable_sort(arr, arr + narr, [](const Arrival &a1, const Arrival &a2) {
+            return a1.delay.real() < a2.delay.real();
+        });
+    } else if(sortMode == 'a') {
+        std::stable_sort(arr, arr + narr, [](const Arrival &a1, const Arrival &a2) {
+            return a1.a > a2.a;
+        });
+    }
+}
+
+/**
+ * LP: Scales the arrival amplitudes, finds the maximum number of arrivals
+ * for each source, optionally sorts each receiver's arrivals, and passes them
+ * to bhcInit::arrivalsCallback if set. Each worker
+ * handles a contiguous range of receivers in the GetFieldAddr layout, and
+ * keeps its own maximum per source, which are combined at the end.
+ *
+ * Multithreaded CPU runs first merge the recorded hits (MergeArrHits), so
+ * the result is the same as a single-threaded run.
+ */
 template<bool O3D, bool R3D> void PostProcessArrivals(
     const bhcParams<O3D> &params, ArrInfo *arrinfo)
 {
+    if(!GetInternal(params)->arrHitFiles.empty()) {
+        MergeArrHits<O3D, R3D>(params, arrinfo);
+    }
+
     const Position *Pos = params.Pos;
-    for(int32_t isz = 0; isz < Pos->NSz; ++isz) {
-        for(int32_t isx = 0; isx < Pos->NSx; ++isx) {
-            for(int32_t isy = 0; isy < Pos->NSy; ++isy) {
-                int32_t maxn = 0; // LP: Maximum number of arrivals for this source
-                for(int32_t itheta = 0; itheta < Pos->Ntheta; ++itheta) {
-                    for(int32_t iz = 0; iz < Pos->NRz_per_range; ++iz) {
-                        for(int32_t ir = 0; ir < Pos->NRr; ++ir) {
-                            size_t base
-                                = GetFieldAddr(isx, isy, isz, itheta, iz, ir, Pos);
+    size_t NSrc         = (size_t)Pos->NSz * (size_t)Pos->NSx * (size_t)Pos->NSy;
+    size_t srcRcvrs     = GetFieldSize(Pos) / NSrc;
+    size_t nRcvrs       = GetFieldSize(Pos);
+    char sortMode       = GetInternal(params)->sortArrivals;
+    auto arrCallback    = GetInternal(params)->arrivalsCallback;
+    ThreadPool &pool    = GetInternal(params)->threadPool;
+    int32_t numThreads  = pool.NumThreads();
+    std::vector<int32_t> workerMaxN((size_t)numThreads * NSrc, 0);
+    Progress &progress = GetInternal(params)->progress;
+    progress.SetUnits(nRcvrs);
+    pool.Run([&](int32_t worker) {
+        size_t rBegin = nRcvrs * worker / numThreads;
+        size_t rEnd   = nRcvrs * (worker + 1) / numThreads;
+        int32_t *maxn = &workerMaxN[(size_t)worker * NSrc];
+        for(size_t base = rBegin; base < rEnd; ++base) {
+            int32_t ir = (int32_t)(base % (size_t)Pos->NRr);
 
-                            int32_t narr = arrinfo->NArr[base];
-                            if(narr > arrinfo->MaxNArr) {
-                                // For multithreading / AllowMerging == false where this
-                                // holds the total number of attempted arrivals,
-                                // including those not written due to limited memory
-                                arrinfo->NArr[base] = narr = arrinfo->MaxNArr;
-                            }
-                            maxn = bhc::max(maxn, narr);
+            int32_t narr = arrinfo->NArr[base];
+            if(narr > arrinfo->MaxNArr) {
+                // For multithreading / AllowMerging == false where this
+                // holds the total number of attempted arrivals,
+                // including those not written due to limited memory
+                arrinfo->NArr[base] = narr = arrinfo->MaxNArr;
+            }
+            size_t isrc = base / srcRcvrs;
+            maxn[isrc]  = bhc::max(maxn[isrc], narr);
 
-                            float factor;
-                            if constexpr(R3D) {
-                                factor = FL(1.0);
-                            } else {
-                                bool line = false; // Silence MSVC warning
-                                if constexpr(!O3D) line = IsLineSource(params.Beam);
-                                if(line) {
-                                    factor = FL(4.0) * STD::sqrt(REAL_PI);
-                                } else if(Pos->Rr[ir] == FL(0.0)) {
-                                    // avoid /0 at origin
-                                    factor = FL(1e5);
-                                } else {
-                                    // cyl. spreading
-                                    factor = FL(1.0) / STD::sqrt(Pos->Rr[ir]);
-                                }
-                            }
-                            for(int32_t iArr = 0; iArr < narr; ++iArr) {
-                                arrinfo->Arr[base * arrinfo->MaxNArr + iArr].a *= factor;
-                            }
-                        }
-                    }
+            float factor;
+            if constexpr(R3D) {
+                factor = FL(1.0);
+            } else {
+                bool line = false; // Silence MSVC warning
+                if constexpr(!O3D) line = IsLineSource(params.Beam);
+                if(line) {
+                    factor = FL(4.0) * STD::sqrt(REAL_PI);
+                } else if(Pos->Rr[ir] == FL(0.0)) {
+                    // avoid /0 at origin
+                    factor = FL(1e5);
+                } else {
+                    // cyl. spreading
+                    factor = FL(1.0) / STD::sqrt(Pos->Rr[ir]);
                 }
-                arrinfo->MaxNPerSource[(isz * Pos->NSx + isx) * Pos->NSy + isy] = maxn;
             }
+            Arrival *arr = &arrinfo->Arr[base * arrinfo->MaxNArr];
+            for(int32_t iArr = 0; iArr < narr; ++iArr) arr[iArr].a *= factor;
+            if(sortMode != 0) SortArrivals(arr, narr, sortMode);
+            if(arrCallback != nullptr) arrCallback(base, arr, narr);
         }
+        progress.Add(rEnd - rBegin);
+    });
+    // LP: Maximum number of arrivals for each source
+    for(size_t isrc = 0; isrc < NSrc; ++isrc) {
+        int32_t maxn = 0;
+        for(int32_t w = 0; w < numThreads; ++w) {
+            maxn = bhc::max(maxn, workerMaxN[(size_t)w * NSrc + isrc]);
+        }
+        arrinfo->MaxNPerSource[isrc] = maxn;
     }
 }
 
@@ -85,10 +186,104 @@ template void PostProcessArrivals<true, true>(
     const bhcParams<true> &params, ArrInfo *arrinfo);
 #endif
 
+/**
+ * Magic number at the start of a bulk .arr file (bhcInit::bulkArrivalsFile).
+ * Ascii .arr files start with '2D' or '3D', and BELLHOP binary ones with a
+ * record length, so they never match it.
+ */
+constexpr char BulkArrMagic[8] = {'B', 'H', 'C', 'A', 'R', 'R', 'B', '1'};
+/**
+ * Bytes of arrivals gathered in memory for each write to or read from a bulk
+ * .arr file.
+ */
+constexpr size_t ArrBulkChunkBytes = size_t(16) << 20;
+
+/**
+ * LP: Bulk version of the .arr file. All values are native-endian:
+ * magic (8 bytes), sizeof(Arrival) and dimension (int32 x2), freq0 (float),
+ * then each coordinate array as its size (int32) followed by its values
+ * (float): O3D only Sx, Sy; Sz, Rz, Rr; O3D only theta. Then MaxNPerSource for
+ * all sources (int32), NArr for all receivers (int32), and finally the NArr
+ * arrivals of each receiver as raw Arrival structs. Sources and receivers are
+ * in the same order as in memory (GetFieldAddr), so the counts are one block
+ * each and the arrivals are copied without any per-field conversion.
+ */
+template<bool O3D> void WriteOutArrivalsBulk(
+    const bhcParams<O3D> &params, const ArrInfo *arrinfo)
+{
+    const Position *Pos = params.Pos;
+    if(!IsArrivalsRun(params.Beam)) {
+        EXTERR("WriteOutArrivals called while not in arrivals mode");
+    }
+    std::ofstream ARRFile(GetInternal(params)->FileRoot + ".arr", std::ios::binary);
+    if(!ARRFile.is_open()) EXTERR("Could not open bulk ARRFile for writing");
+
+    auto put = [&](const void *data, size_t bytes) {
+        ARRFile.write((const char *)data, bytes);
+    };
+    auto putArray = [&](const float *v, int32_t n) {
+        put(&n, sizeof(n));
+        put(v, (size_t)n * sizeof(float));
+    };
+
+    int32_t format[2] = {(int32_t)sizeof(Arrival), O3D ? 3 : 2};
+    float freq0       = (float)params.freqinfo->freq0;
+    put(BulkArrMagic, sizeof(BulkArrMagic));
+    put(format, sizeof(format));
+    put(&freq0, sizeof(freq0));
+    if constexpr(O3D) {
+        putArray(Pos->Sx, Pos->NSx);
+        putArray(Pos->Sy, Pos->NSy);
+    }
+    putArray(Pos->Sz, Pos->NSz);
+    putArray(Pos->Rz, Pos->NRz);
+    putArray(Pos->Rr, Pos->NRr);
+    if constexpr(O3D) putArray(Pos->theta, Pos->Ntheta);
+
+    size_t nSrcs  = (size_t)Pos->NSx * Pos->NSy * Pos->NSz;
+    size_t nRcvrs = GetFieldSize(Pos);
+    put(arrinfo->MaxNPerSource, nSrcs * sizeof(int32_t));
+    put(arrinfo->NArr, nRcvrs * sizeof(int32_t));
+
+    // LP: The arrivals of each receiver are contiguous in Arr but padded out to
+    // MaxNArr, so they are packed into a large buffer and written in big
+    // sequential blocks.
+    Progress &progress = GetInternal(params)->progress;
+    progress.SetUnits(nRcvrs);
+    size_t chunkArrs = std::max(ArrBulkChunkBytes / sizeof(Arrival), (size_t)1);
+    std::vector<Arrival> buf;
+    buf.reserve(chunkArrs);
+    size_t rcvrsInBuf = 0;
+    for(size_t base = 0; base < nRcvrs; ++base) {
+        const Arrival *arr = &arrinfo->Arr[base * arrinfo->MaxNArr];
+        size_t narr        = (size_t)arrinfo->NArr[base];
+        if(buf.size() + narr > chunkArrs) {
+            put(buf.data(), buf.size() * sizeof(Arrival));
+            buf.clear();
+            progress.Add(rcvrsInBuf);
+            rcvrsInBuf = 0;
+        }
+        if(narr > chunkArrs) {
+            put(arr, narr * sizeof(Arrival));
+            progress.Add(1);
+        } else {
+            buf.insert(buf.end(), arr, arr + narr);
+            ++rcvrsInBuf;
+        }
+    }
+    put(buf.data(), buf.size() * sizeof(Arrival));
+    progress.Add(rcvrsInBuf);
+    if(!ARRFile.good()) EXTERR("Failed to write bulk ARRFile");
+}
+
 template<bool O3D> void WriteOutArrivals(
     const bhcParams<O3D> &params, const ArrInfo *arrinfo)
 {
     const Position *Pos = params.Pos;
+    if(GetInternal(params)->bulkArrivalsFile) {
+        WriteOutArrivalsBulk<O3D>(params, arrinfo);
+        return;
+    }
 
     // LP: originally most of OpenOutputFiles
     bool isAscii;
@@ -167,6 +362,8 @@ template<bool O3D> void WriteOutArrivals(
         break;
     default: EXTERR("WriteOutArrivals called while not in arrivals mode");
     }
+    Progress &progress = GetInternal(params)->progress;
+    progress.SetUnits(GetFieldSize(Pos));
     // LP: originally most of WriteArrivals[ASCII/Binary][3D]
     for(int32_t isz = 0; isz < Pos->NSz; ++isz) {
         for(int32_t isx = 0; isx < Pos->NSx; ++isx) {
@@ -230,6 +427,7 @@ template<bool O3D> void WriteOutArrivals(
                                 }
                             }
                         }
+                        progress.Add(Pos->NRr);
                     }
                 }
             }
@@ -272,12 +470,120 @@ template<bool O3D> inline void ReadArrivalsArray(
     }
 }
 
+/**
+ * Reads a bulk .arr file (see WriteOutArrivalsBulk). ARRFile is positioned just
+ * after the magic number.
+ */
+template<bool O3D, bool R3D> void ReadOutArrivalsBulk(
+    bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs, std::ifstream &ARRFile)
+{
+    Position *Pos    = params.Pos;
+    ArrInfo *arrinfo = outputs.arrinfo;
+
+    auto get = [&](void *data, size_t bytes) {
+        ARRFile.read((char *)data, bytes);
+        if(!ARRFile.good()) EXTERR("Bulk ARRFile is truncated or unreadable");
+    };
+    auto getArray = [&](float *&v, int32_t &n, const char *description) {
+        get(&n, sizeof(n));
+        if(n < 0) EXTERR("Invalid number of %s in bulk ARRFile", description);
+        trackallocate(params, description, v, n);
+        get(v, (size_t)n * sizeof(float));
+    };
+
+    int32_t format[2];
+    get(format, sizeof(format));
+    if(format[0] != (int32_t)sizeof(Arrival)) {
+        EXTERR(
+            "Bulk ARRFile was written with %d-byte arrivals, but this build uses %d",
+            format[0], (int32_t)sizeof(Arrival));
+    }
+    if(format[1] != (O3D ? 3 : 2)) {
+        EXTERR(
+            "Incorrect dimensionality in arrivals file, must be %s, got %dD",
+            O3D ? "3D" : "2D", format[1]);
+    }
+    float freq0;
+    get(&freq0, sizeof(freq0));
+    params.freqinfo->freq0 = freq0;
+
+    if constexpr(O3D) {
+        getArray(Pos->Sx, Pos->NSx, "source x-coordinates");
+        getArray(Pos->Sy, Pos->NSy, "source y-coordinates");
+    }
+    getArray(Pos->Sz, Pos->NSz, "source z-coordinates");
+    getArray(Pos->Rz, Pos->NRz, "receiver z-coordinates");
+    getArray(Pos->Rr, Pos->NRr, "receiver r-coordinates");
+    if constexpr(O3D) getArray(Pos->theta, Pos->Ntheta, "receiver theta-coordinates");
+
+    if(IsIrregularGrid(params.Beam)) {
+        EXTERR("Arrivals readout (and actually writeout) is not compatible with "
+               "irregular grid");
+    }
+    Pos->NRz_per_range = Pos->NRz;
+    Arr<O3D, R3D> arrmode;
+    arrmode.Preprocess(params, outputs, false);
+
+    size_t nSrcs  = (size_t)Pos->NSx * Pos->NSy * Pos->NSz;
+    size_t nRcvrs = GetFieldSize(Pos);
+    get(arrinfo->MaxNPerSource, nSrcs * sizeof(int32_t));
+    get(arrinfo->NArr, nRcvrs * sizeof(int32_t));
+
+    // LP: Arrivals for many receivers are read at once, and then copied to
+    // their (MaxNArr-padded) slots in Arr. Arrivals beyond MaxNArr for a
+    // receiver are dropped, as in the other formats.
+    size_t chunkArrs = std::max(ArrBulkChunkBytes / sizeof(Arrival), (size_t)1);
+    std::vector<Arrival> buf;
+    size_t nTruncated = 0;
+    size_t base       = 0;
+    while(base < nRcvrs) {
+        size_t baseEnd = base, total = 0;
+        do {
+            int32_t narr = arrinfo->NArr[baseEnd];
+            if(narr < 0) EXTERR("Invalid number of arrivals in bulk ARRFile");
+            total += (size_t)narr;
+            ++baseEnd;
+        } while(baseEnd < nRcvrs && total + (size_t)arrinfo->NArr[baseEnd] <= chunkArrs);
+        buf.resize(total);
+        get(buf.data(), total * sizeof(Arrival));
+
+        const Arrival *src = buf.data();
+        for(; base < baseEnd; ++base) {
+            int32_t narr = arrinfo->NArr[base];
+            if(narr > arrinfo->MaxNArr) {
+                arrinfo->NArr[base] = arrinfo->MaxNArr;
+                ++nTruncated;
+            }
+            memcpy(
+                &arrinfo->Arr[base * arrinfo->MaxNArr], src,
+                (size_t)arrinfo->NArr[base] * sizeof(Arrival));
+            src += narr;
+        }
+    }
+    if(nTruncated > 0) {
+        EXTWARN(
+            "%zu receivers have more arrivals in file than the %d there is memory "
+            "for, extra arrivals dropped",
+            nTruncated, arrinfo->MaxNArr);
+    }
+}
+
 template<bool O3D, bool R3D> void ReadOutArrivals(
     bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs, const char *FileRoot)
 {
     Position *Pos    = params.Pos;
     ArrInfo *arrinfo = outputs.arrinfo;
 
+    if(IsArrivalsRun(params.Beam)) {
+        std::ifstream BulkARRFile(std::string(FileRoot) + ".arr", std::ios::binary);
+        char magic[sizeof(BulkArrMagic)];
+        if(BulkARRFile.read(magic, sizeof(magic))
+           && memcmp(magic, BulkArrMagic, sizeof(magic)) == 0) {
+            ReadOutArrivalsBulk<O3D, R3D>(params, outputs, BulkARRFile);
+            return;
+        }
+    }
+
     bool isAscii;
     LDIFile AARRFile(GetInternal(params));
     UnformattedIFile BARRFile(GetInternal(params));
@@ -348,7 +654,7 @@ template<bool O3D, bool R3D> void ReadOutArrivals(
     }
     Pos->NRz_per_range = Pos->NRz;
     Arr<O3D, R3D> arrmode;
-    arrmode.Preprocess(params, outputs);
+    arrmode.Preprocess(params, outputs, false);
 
     Arrival dummy_arr;
     for(int32_t isz = 0; isz < Pos->NSz; ++isz) {
@@ -23,6 +23,13 @@ this program. If not, see <https://www.gnu.org/licenses/>.
 
 namespace bhc { namespace mode {
 
+template<bool O3D> inline void FreeHits(const bhcParams<O3D> &params)
+{
+    for(FILE *f : GetInternal(params)->arrHitFiles) fclose(f);
+    GetInternal(params)->arrHitFiles.clear();
+    GetInternal(params)->arrHitSegments.clear();
+}
+
 template<bool O3D, bool R3D> void PostProcessArrivals(
     const bhcParams<O3D> &params, ArrInfo *arrinfo);
 extern template void PostProcessArrivals<false, false>(
@@ -63,6 +70,16 @@ public:
 
     virtual void Preprocess(
         bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs) const override
+    {
+        Preprocess(params, outputs, UseRayFan(params));
+    }
+
+    /**
+     * rayFan: whether to make room for and allocate a ray fan (see
+     * bhcInit::reuseRayFan); false when reading an .arr file.
+     */
+    void Preprocess(
+        bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs, bool rayFan) const
     {
         // Allocate Room for eigenrays first, if needed
         if(IsAlsoEigenraysRun(params.Beam)) {
@@ -76,15 +93,43 @@ public:
         trackdeallocate(params, arrinfo->Arr);
         trackdeallocate(params, arrinfo->NArr);
         trackdeallocate(params, arrinfo->MaxNPerSource);
+        FreeHits(params);
+#ifdef BHC_BUILD_CUDA
         arrinfo->AllowMerging = GetInternal(params)->numThreads == 1;
-        size_t nSrcs          = params.Pos->NSx * params.Pos->NSy * params.Pos->NSz;
-        size_t nSrcsRcvrs     = nSrcs * params.Pos->Ntheta * params.Pos->NRr
+#else
+        // LP: Multithreaded runs record the hits in a temporary file for each
+        // worker, to be merged in ray order after the run (see MergeArrHits).
+        // If there are no files, the hits are merged as they are added, by a
+        // single worker (see FieldModesWorker).
+        arrinfo->AllowMerging = true;
+        if(GetInternal(params)->numThreads > 1) {
+            std::vector<FILE *> &files = GetInternal(params)->arrHitFiles;
+            for(int32_t w = 0; w < GetInternal(params)->numThreads; ++w) {
+                FILE *f = std::tmpfile();
+                if(f == nullptr) {
+                    FreeHits(params);
+                    EXTWARN("Could not create temporary files to merge arrivals from "
+                            "multiple threads, computing arrivals single-threaded");
+                    break;
+                }
+                files.push_back(f);
+            }
+        }
+#endif
+        size_t nSrcs      = params.Pos->NSx * params.Pos->NSy * params.Pos->NSz;
+        size_t nSrcsRcvrs = nSrcs * params.Pos->Ntheta * params.Pos->NRr
             * params.Pos->NRz_per_range;
         int64_t remainingMemory = GetInternal(params)->maxMemory
             - GetInternal(params)->usedMemory;
         remainingMemory -= nSrcsRcvrs * sizeof(int32_t);
         remainingMemory -= nSrcs * sizeof(int32_t);
-        if(IsAlsoEigenraysRun(params.Beam)) { remainingMemory -= remainingMemory / 2; }
+        if(IsAlsoEigenraysRun(params.Beam) && !outputs.eigen->singlePass) {
+            remainingMemory -= remainingMemory / 2;
+        }
+        // LP: Leave half for a new ray fan, allocated below.
+        if(rayFan && !outputs.rayinfo->isRayFan) {
+            remainingMemory -= remainingMemory / 2;
+        }
         remainingMemory -= 32 * 3; // Possible padding used for the three arrays
         remainingMemory  = std::max(remainingMemory, (int64_t)0);
         arrinfo->MaxNArr = (int32_t)std::min<int32_t>(
@@ -105,6 +150,10 @@ public:
         memset(arrinfo->Arr, 0, nSrcsRcvrs * (size_t)arrinfo->MaxNArr * sizeof(Arrival));
         memset(arrinfo->NArr, 0, nSrcsRcvrs * sizeof(int32_t));
         // MaxNPerSource does not have to be initialized
+
+        if(rayFan) {
+            this->PreprocessRayFan(params, outputs, GetInternal(params)->maxMemory);
+        }
     }
 
     virtual void Postprocess(
@@ -132,6 +181,7 @@ public:
         trackdeallocate(params, outputs.arrinfo->Arr);
         trackdeallocate(params, outputs.arrinfo->NArr);
         trackdeallocate(params, outputs.arrinfo->MaxNPerSource);
+        FreeHits(params);
     }
 };
 
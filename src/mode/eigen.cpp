@@ -25,24 +25,35 @@ template<bool O3D, bool R3D> void EigenModePostWorker(
     const bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs, int32_t worker,
     ErrState *errState)
 {
-    SetupThread();
-    while(true) {
-        int32_t job = GetInternal(params)->sharedJobID++;
-        if(job >= bhc::min(outputs.eigen->neigen, outputs.eigen->memsize)) break;
-        EigenHit *hit  = &outputs.eigen->hits[job];
-        int32_t Nsteps = hit->is;
-        RayInitInfo rinit;
-        rinit.isx    = hit->isx;
-        rinit.isy    = hit->isy;
-        rinit.isz    = hit->isz;
-        rinit.ialpha = hit->ialpha;
-        rinit.ibeta  = hit->ibeta;
-        if(!RunRay<O3D, R3D>(
-               outputs.rayinfo, params, job, worker, rinit, Nsteps, errState)) {
-            // Already gave out of memory error; that is the only condition leading
-            // here printf("EigenModePostWorker RunRay failed\n");
-            break;
+    JobScheduler &jobScheduler = GetInternal(params)->jobScheduler;
+    Progress &progress         = GetInternal(params)->progress;
+    // LP: Hits are recorded roughly in job order, so consecutive re-traces
+    // mostly share a source.
+    RaySourceCache<O3D> srcCache;
+    InitRaySourceCache(&srcCache);
+    int32_t job, jobEnd;
+    bool going = true;
+    while(going && jobScheduler.Next(worker, job, jobEnd)) {
+        int32_t jobStart = job;
+        for(; job < jobEnd; ++job) {
+            EigenHit *hit  = &outputs.eigen->hits[job];
+            int32_t Nsteps = hit->is;
+            RayInitInfo rinit;
+            rinit.isx    = hit->isx;
+            rinit.isy    = hit->isy;
+            rinit.isz    = hit->isz;
+            rinit.ialpha = hit->ialpha;
+            rinit.ibeta  = hit->ibeta;
+            if(!RunRay<O3D, R3D>(
+                   outputs.rayinfo, params, job, worker, rinit, Nsteps, &srcCache,
+                   errState)) {
+                // Already gave out of memory error; that is the only condition
+                // leading here printf("EigenModePostWorker RunRay failed\n");
+                going = false;
+                break;
+            }
         }
+        progress.Add(job - jobStart);
     }
 }
 
@@ -62,12 +73,43 @@ template void EigenModePostWorker<true, true>(
     ErrState *errState);
 #endif
 
-template<bool O3D, bool R3D> void PostProcessEigenrays(
+/**
+ * Single-pass eigenrays: makes one ray result per hit, from the ray kept
+ * during the field pass for that hit's job, cut off where a re-trace would
+ * have stopped.
+ */
+template<bool O3D, bool R3D> void PostProcessEigenraysSinglePass(
     bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs)
 {
-    Ray<O3D, R3D> raymode;
-    raymode.Preprocess(params, outputs);
+    RayInfo<O3D, R3D> *rayinfo      = outputs.rayinfo;
+    const EigenInfo *eigen          = outputs.eigen;
+    RayResult<O3D, R3D> *jobResults = rayinfo->results;
+    rayinfo->results                = nullptr;
+    int32_t n                       = bhc::min(eigen->neigen, eigen->memsize);
+    trackallocate(params, "ray metadata", rayinfo->results, n);
+    for(int32_t i = 0; i < n; ++i) {
+        const EigenHit *hit = &eigen->hits[i];
+        int32_t job         = GetJobNumber<O3D>(
+            hit->isx, hit->isy, hit->isz, hit->ialpha, hit->ibeta, params.Pos,
+            params.Angles);
+        RayResult<O3D, R3D> *res = &rayinfo->results[i];
+        *res                     = jobResults[job];
+        res->Nsteps              = bhc::min(hit->Nsteps, res->Nsteps);
+        if(res->ray != nullptr && GetInternal(params)->rayCallback != nullptr) {
+            GetInternal(params)->rayCallback(i, res);
+        }
+    }
+    rayinfo->NRays = n;
+    trackdeallocate(params, jobResults);
+    trackdeallocate(params, rayinfo->WorkRayMem);
+    // LP: Not calling Ray::Postprocess, as CompressRay works in place and the
+    // results for hits on the same ray share their points. (With the current
+    // constants, CompressRay does nothing anyway.)
+}
 
+template<bool O3D, bool R3D> void PostProcessEigenrays(
+    bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs)
+{
     if(outputs.eigen->neigen > outputs.eigen->memsize) {
         EXTWARN(
             "Would have had %d eigenrays but only %d metadata fit in memory\n",
@@ -76,16 +118,25 @@ template<bool O3D, bool R3D> void PostProcessEigenrays(
         EXTWARN("%d eigenrays\n", (int)outputs.eigen->neigen);
     }
 
+    if(outputs.eigen->singlePass) {
+        PostProcessEigenraysSinglePass<O3D, R3D>(params, outputs);
+        return;
+    }
+
+    Ray<O3D, R3D> raymode;
+    raymode.Preprocess(params, outputs);
+
     ErrState errState;
     ResetErrState(&errState);
-    GetInternal(params)->sharedJobID = 0;
-    int32_t numThreads               = GetInternal(params)->numThreads;
-    std::vector<std::thread> threads;
-    for(int32_t i = 0; i < numThreads; ++i)
-        threads.push_back(std::thread(
-            EigenModePostWorker<O3D, R3D>, std::cref(params), std::ref(outputs), i,
-            &errState));
-    for(int32_t i = 0; i < numThreads; ++i) threads[i].join();
+    int32_t nHits = bhc::min(outputs.eigen->neigen, outputs.eigen->memsize);
+    GetInternal(params)->jobScheduler.Reset(nHits);
+    GetInternal(params)->progress.SetUnits(nHits);
+    {
+        CancelScope cancelScope(GetInternal(params), &errState);
+        GetInternal(params)->threadPool.Run([&](int32_t worker) {
+            EigenModePostWorker<O3D, R3D>(params, outputs, worker, &errState);
+        });
+    }
     CheckReportErrors(GetInternal(params), &errState);
 
     raymode.Postprocess(params, outputs);
@@ -39,9 +39,10 @@ public:
 
     virtual void Init(bhcOutputs<O3D, R3D> &outputs) const override
     {
-        outputs.eigen->hits    = nullptr;
-        outputs.eigen->neigen  = 0;
-        outputs.eigen->memsize = 0;
+        outputs.eigen->hits       = nullptr;
+        outputs.eigen->neigen     = 0;
+        outputs.eigen->memsize    = 0;
+        outputs.eigen->singlePass = false;
     }
 
     virtual void Preprocess(
@@ -67,6 +68,16 @@ public:
         }
         trackallocate(params, "eigenray hits", eigen->hits, eigen->memsize);
         eigen->neigen = 0;
+
+        eigen->singlePass = GetInternal(params)->singlePassEigenrays;
+#ifdef BHC_BUILD_CUDA
+        if(eigen->singlePass) {
+            EXTWARN("Single-pass eigenrays are not supported on the GPU, rays will be "
+                    "re-traced");
+            eigen->singlePass = false;
+        }
+#endif
+        if(eigen->singlePass) PreprocessSinglePass(params, outputs);
     }
 
     virtual void Postprocess(
@@ -87,6 +98,42 @@ public:
     {
         trackdeallocate(params, outputs.eigen->hits);
     }
+
+private:
+    /**
+     * Allocates the ray memory for single-pass eigenrays. During the field
+     * pass, rayinfo->results is indexed by job, and each worker traces into
+     * its own MaxN points of WorkRayMem; rays which hit a receiver are copied
+     * into RayMem (see StoreEigenRay).
+     */
+    inline void PreprocessSinglePass(
+        bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs) const
+    {
+        RayInfo<O3D, R3D> *rayinfo = outputs.rayinfo;
+        trackdeallocate(params, rayinfo->RayMem);
+        trackdeallocate(params, rayinfo->WorkRayMem);
+        trackdeallocate(params, rayinfo->WorkerChunks);
+        rayinfo->NRays = GetNumJobs<O3D>(params.Pos, params.Angles);
+        trackallocate(params, "ray metadata", rayinfo->results, rayinfo->NRays);
+        memset(rayinfo->results, 0, rayinfo->NRays * sizeof(RayResult<O3D, R3D>));
+        trackallocate(
+            params, "work rays for single-pass eigenrays", rayinfo->WorkRayMem,
+            GetInternal(params)->numThreads * MaxN);
+        rayinfo->MaxPointsPerRay = MaxN;
+        rayinfo->isCopyMode      = true;
+
+        // Leave room for the per-hit ray metadata in PostProcessEigenrays, and
+        // for the arrivals if this is also an arrivals run.
+        int64_t mem = GetInternal(params)->maxMemory - GetInternal(params)->usedMemory;
+        mem -= (int64_t)outputs.eigen->memsize * sizeof(RayResult<O3D, R3D>) + 64;
+        if(IsAlsoEigenraysRun(params.Beam)) mem /= 2;
+        rayinfo->RayMemCapacity = std::max(mem, (int64_t)0) / sizeof(rayPt<R3D>);
+        if(rayinfo->RayMemCapacity == 0) {
+            EXTERR("Insufficient memory to allocate any rays at all");
+        }
+        trackallocate(params, "rays", rayinfo->RayMem, rayinfo->RayMemCapacity);
+        rayinfo->RayMemPoints = 0;
+    }
 };
 
 }} // namespace bhc::mode
@@ -21,6 +21,69 @@ this program. If not, see <https://www.gnu.org/licenses/>.
 
 namespace bhc { namespace mode {
 
+template<bool O3D, bool R3D> FieldTiles<O3D, R3D>::FieldTiles(
+    bhcParams<O3D> &params_, bhcOutputs<O3D, R3D> &outputs_)
+    : params(params_), outputs(outputs_), tiles(nullptr), n(0), numJobs(0), nBlocks(0)
+{
+    if(!IsTLRun(params.Beam)) return;
+    // LP: The mapped field may be larger than memory, so don't copy it.
+    if(params.Pos->TLRecCpxf != 0) return;
+    n       = GetTLFieldSize(params.Pos, params.freqinfo);
+    numJobs = GetNumJobs<O3D>(params.Pos, params.Angles);
+    if(n == 0 || numJobs <= 1) return;
+    // Same size computation as trackallocate, so we never fail in there.
+    uint64_t tileBytes = (uint64_t)n * sizeof(cpxf);
+    uint64_t maxMemory = GetInternal(params)->maxMemory;
+    uint64_t used      = GetInternal(params)->usedMemory + 32ull;
+    uint64_t avail     = maxMemory > used ? maxMemory - used : 0ull;
+    int32_t nb = (int32_t)std::min<uint64_t>(
+        std::min(MaxBlocks, numJobs), 1ull + avail / tileBytes);
+    if(nb < std::min(MinBlocks, numJobs)) return;
+    trackallocate(params, "TL field tiles", tiles, (size_t)(nb - 1) * n);
+    nBlocks = nb;
+}
+
+template<bool O3D, bool R3D> FieldTiles<O3D, R3D>::~FieldTiles()
+{
+    trackdeallocate(params, tiles);
+}
+
+template<bool O3D, bool R3D> cpxf *FieldTiles<O3D, R3D>::BlockField(int32_t b)
+{
+    if(b == 0) return outputs.uAllSources;
+    cpxf *tile = &tiles[(size_t)(b - 1) * n];
+    memset(tile, 0, n * sizeof(cpxf));
+    return tile;
+}
+
+template<bool O3D, bool R3D> void FieldTiles<O3D, R3D>::Reduce()
+{
+    if(tiles == nullptr) return;
+    ThreadPool &pool   = GetInternal(params)->threadPool;
+    int32_t numThreads = pool.NumThreads();
+    pool.Run([&](int32_t worker) {
+        size_t b = n * worker / numThreads;
+        size_t e = n * (worker + 1) / numThreads;
+        // LP: Each element gets the blocks added in block order, regardless of
+        // which thread does the adding or which worker ran each block.
+        for(int32_t t = 0; t < nBlocks - 1; ++t) {
+            const cpxf *tile = &tiles[(size_t)t * n];
+            for(size_t i = b; i < e; ++i) outputs.uAllSources[i] += tile[i];
+        }
+    });
+    trackdeallocate(params, tiles);
+}
+
+#if BHC_ENABLE_2D
+template class FieldTiles<false, false>;
+#endif
+#if BHC_ENABLE_NX2D
+template class FieldTiles<true, false>;
+#endif
+#if BHC_ENABLE_3D
+template class FieldTiles<true, true>;
+#endif
+
 template<char RT, char IT, bool O3D, bool R3D> inline void RunFieldModesSelSSP(
     bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs)
 {
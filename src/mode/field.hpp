@@ -20,6 +20,7 @@ this program. If not, see <https://www.gnu.org/licenses/>.
 #include "../common_setup.hpp"
 #include "modemodule.hpp"
 #include "fieldimpl.hpp"
+#include "ray.hpp"
 #include "../influence.hpp"
 
 namespace bhc { namespace mode {
@@ -32,15 +33,62 @@ public:
     Field() {}
     virtual ~Field() {}
 
-    virtual void Preprocess(bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &) const override
+    virtual void Preprocess(
+        bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs) const override
     {
         PreRun_Influence<O3D, R3D>(params);
+        params.Pos->TLRecCpxf = 0; // LP: Set by TL if the field is mapped
+        // LP: Free the ray fan from an earlier run unless this run can reuse
+        // it, before the subclass allocates its outputs.
+        RayInfo<O3D, R3D> *rayinfo = outputs.rayinfo;
+        if(rayinfo->isRayFan && !ReuseRayFan(params, outputs)) {
+            Ray<O3D, R3D> R;
+            R.Finalize(params, outputs);
+            rayinfo->isRayFan  = false;
+            rayinfo->fanTraced = false;
+        }
     }
 
     virtual void Run(bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs) const override
     {
+        RayInfo<O3D, R3D> *rayinfo = outputs.rayinfo;
+        if(rayinfo->isRayFan && !rayinfo->fanTraced) {
+            // LP: Trace the fan first; the field pass then only applies the
+            // influence of the stored rays.
+            GetInternal(params)->progress.SetUnits(
+                2 * (int64_t)GetNumJobs<O3D>(params.Pos, params.Angles));
+            RunRayMode<O3D, R3D>(params, outputs);
+            rayinfo->fanTraced = true;
+            rayinfo->fanKey    = GetInternal(params)->rayFanKey;
+        }
         RunFieldModesSelInfl<O3D, R3D>(params, outputs);
     }
+
+protected:
+    /**
+     * Whether the ray fan in rayinfo was traced in the same environment as
+     * this run, so the rays need not be traced again.
+     */
+    inline bool ReuseRayFan(
+        const bhcParams<O3D> &params, const bhcOutputs<O3D, R3D> &outputs) const
+    {
+        const RayInfo<O3D, R3D> *rayinfo = outputs.rayinfo;
+        return UseRayFan(params) && rayinfo->isRayFan && rayinfo->fanTraced
+            && rayinfo->fanKey == GetInternal(params)->rayFanKey;
+    }
+
+    /**
+     * Call at the end of the subclass's Preprocess. Allocates a new ray fan
+     * with memory up to maxMemory, if this run uses one and cannot reuse the
+     * one from an earlier run.
+     */
+    inline void PreprocessRayFan(
+        bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs, size_t maxMemory) const
+    {
+        if(!UseRayFan(params) || outputs.rayinfo->isRayFan) return;
+        Ray<O3D, R3D> R;
+        R.PreprocessFan(params, outputs, maxMemory);
+    }
 };
 
 }} // namespace bhc::mode
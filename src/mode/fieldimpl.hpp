@@ -21,8 +21,74 @@ this program. If not, see <https://www.gnu.org/licenses/>.
 
 namespace bhc { namespace mode {
 
+/**
+ * Copies ("tiles") of the TL field for CPU runs, so that the workers do not all
+ * contend on atomic adds into the shared uAllSources, and so that the result
+ * does not depend on the number of threads.
+ *
+ * The jobs (rays) are split into a fixed number of contiguous blocks, which
+ * depends on the number of jobs and on the memory available, but not on the
+ * number of threads. The job scheduler hands out whole blocks, including when
+ * stealing. Block 0 is accumulated directly into uAllSources, and every other
+ * block into its own tile, each in ray order by the one worker running it; at
+ * the end of the run, the tiles are added into uAllSources in block order, in
+ * parallel over the field. The result is therefore the same for every run
+ * and every number of threads, though it differs from BELLHOP(3D) (which adds
+ * all rays in order) in the last bits.
+ *
+ * Only used for TL runs, and only if there is enough memory (under maxMemory)
+ * for at least MinBlocks blocks. Otherwise, all workers share uAllSources with
+ * atomics as before, and the result depends on the order the rays finish in.
+ */
+template<bool O3D, bool R3D> class FieldTiles {
+public:
+    FieldTiles(bhcParams<O3D> &params_, bhcOutputs<O3D, R3D> &outputs_);
+    ~FieldTiles();
+
+    FieldTiles(const FieldTiles &)            = delete;
+    FieldTiles &operator=(const FieldTiles &) = delete;
+
+    /// Whether the jobs are split into blocks, each with its own field.
+    inline bool Enabled() const { return nBlocks > 0; }
+    /// Number of blocks, which are the units given out by the job scheduler.
+    inline int32_t NumBlocks() const { return nBlocks; }
+    /// First job of block b; block b is [BlockBegin(b), BlockBegin(b + 1)).
+    inline int32_t BlockBegin(int32_t b) const
+    {
+        return (int32_t)((int64_t)numJobs * b / nBlocks);
+    }
+    /// Field for block b to accumulate into, only written by the worker
+    /// running the block. Call once per block when starting it; clears the
+    /// block's tile.
+    cpxf *BlockField(int32_t b);
+    /// Sum the tiles into uAllSources. Call after all workers have finished.
+    void Reduce();
+
+private:
+    // LP: Most blocks, i.e. the most workers which can be kept busy.
+    static constexpr int32_t MaxBlocks = 64;
+    // LP: Fewest blocks worth using, otherwise the workers share uAllSources.
+    static constexpr int32_t MinBlocks = 8;
+
+    bhcParams<O3D> &params;
+    bhcOutputs<O3D, R3D> &outputs;
+    cpxf *tiles;
+    size_t n;
+    int32_t numJobs, nBlocks;
+};
+#if BHC_ENABLE_2D
+extern template class FieldTiles<false, false>;
+#endif
+#if BHC_ENABLE_NX2D
+extern template class FieldTiles<true, false>;
+#endif
+#if BHC_ENABLE_3D
+extern template class FieldTiles<true, true>;
+#endif
+
 template<typename CFG, bool O3D, bool R3D> void FieldModesWorker(
-    bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs, ErrState *errState);
+    bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs, int32_t worker,
+    FieldTiles<O3D, R3D> &tiles, ErrState *errState);
 
 template<typename CFG, bool O3D, bool R3D> void RunFieldModesImpl(
     bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs);
@@ -23,70 +23,131 @@ this program. If not, see <https://www.gnu.org/licenses/>.
 
 namespace bhc { namespace mode {
 
+/**
+ * Takes a new chunk of at least npoints points of RayMem for this worker.
+ */
+template<bool O3D, bool R3D> inline bool NewRayMemChunk(
+    RayInfo<O3D, R3D> *rayinfo, RayMemChunk *chunk, size_t npoints)
+{
+    npoints  = bhc::max(npoints, RayMemChunkPoints);
+    size_t p = AtomicFetchAdd(&rayinfo->RayMemPoints, npoints);
+    if(p + npoints > rayinfo->RayMemCapacity) return false;
+    chunk->begin = p;
+    chunk->end   = p + npoints;
+    return true;
+}
+
 template<bool O3D, bool R3D> bool RunRay(
     RayInfo<O3D, R3D> *rayinfo, const bhcParams<O3D> &params, int32_t job, int32_t worker,
-    RayInitInfo &rinit, int32_t &Nsteps, ErrState *errState)
+    RayInitInfo &rinit, int32_t &Nsteps, RaySourceCache<O3D> *srcCache,
+    ErrState *errState)
 {
     if(job >= rayinfo->NRays || worker >= GetInternal(params)->numThreads) {
         RunError(errState, BHC_ERR_JOBNUM);
         return false;
     }
     rayPt<R3D> *ray;
+    int32_t capacity;
+    RayMemChunk *chunk = nullptr;
     if(rayinfo->isCopyMode) {
-        ray = &rayinfo->WorkRayMem[worker * rayinfo->MaxPointsPerRay];
+        ray      = &rayinfo->WorkRayMem[worker * rayinfo->MaxPointsPerRay];
+        capacity = rayinfo->MaxPointsPerRay;
     } else {
-        ray = &rayinfo->RayMem[(size_t)job * rayinfo->MaxPointsPerRay];
+        // LP: Trace directly into the rest of this worker's chunk of RayMem.
+        chunk = &rayinfo->WorkerChunks[worker];
+        if(chunk->end - chunk->begin < 3 && !NewRayMemChunk(rayinfo, chunk, 3)) {
+            // LP: Rays which do not fit in the ray fan are just traced in the
+            // field pass, so that is not worth a warning.
+            if(!rayinfo->isRayFan) RunWarning(errState, BHC_WARN_RAYS_OUTOFMEMORY);
+            rayinfo->results[job].ray = nullptr;
+            return false;
+        }
+        ray      = &rayinfo->RayMem[chunk->begin];
+        capacity = (int32_t)bhc::min(
+            chunk->end - chunk->begin, (size_t)rayinfo->MaxPointsPerRay);
     }
 #ifdef BHC_DEBUG
     // Set to garbage values for debugging
-    memset(ray, 0xFE, rayinfo->MaxPointsPerRay * sizeof(rayPt<R3D>));
+    memset(ray, 0xFE, capacity * sizeof(rayPt<R3D>));
 #endif
+    // LP: Ray outgrew the rest of the chunk; move it to a new chunk (the rest
+    // of the old chunk is not used again).
+    bool outOfMemory = false;
+    auto grow = [&](rayPt<R3D> *&r, int32_t &cap, int32_t npoints) {
+        if(chunk == nullptr) return false;
+        size_t newcap = bhc::min(2 * (size_t)cap, (size_t)rayinfo->MaxPointsPerRay);
+        if(!NewRayMemChunk(rayinfo, chunk, newcap)) {
+            outOfMemory = true;
+            return false;
+        }
+        rayPt<R3D> *r2 = &rayinfo->RayMem[chunk->begin];
+        memcpy(r2, r, npoints * sizeof(rayPt<R3D>));
+        r   = r2;
+        cap = (int32_t)bhc::min(
+            chunk->end - chunk->begin, (size_t)rayinfo->MaxPointsPerRay);
+        return true;
+    };
 
     Origin<O3D, R3D> org;
     char st = params.ssp->Type;
     if(st == 'N') {
         MainRayMode<CfgSel<'R', 'G', 'N'>, O3D, R3D>(
-            rinit, ray, Nsteps, rayinfo->MaxPointsPerRay, org, params.Bdry, params.bdinfo,
-            params.refl, params.ssp, params.Pos, params.Angles, params.freqinfo,
-            params.Beam, params.sbp, errState);
+            rinit, ray, Nsteps, rayinfo->MaxPointsPerRay, capacity, grow, org,
+            params.Bdry, params.bdinfo, params.refl, params.ssp, params.Pos,
+            params.Angles, params.freqinfo, params.Beam, params.sbp, srcCache, errState);
     } else if(st == 'C') {
         MainRayMode<CfgSel<'R', 'G', 'C'>, O3D, R3D>(
-            rinit, ray, Nsteps, rayinfo->MaxPointsPerRay, org, params.Bdry, params.bdinfo,
-            params.refl, params.ssp, params.Pos, params.Angles, params.freqinfo,
-            params.Beam, params.sbp, errState);
+            rinit, ray, Nsteps, rayinfo->MaxPointsPerRay, capacity, grow, org,
+            params.Bdry, params.bdinfo, params.refl, params.ssp, params.Pos,
+            params.Angles, params.freqinfo, params.Beam, params.sbp, srcCache, errState);
     } else if(st == 'S') {
         MainRayMode<CfgSel<'R', 'G', 'S'>, O3D, R3D>(
-            rinit, ray, Nsteps, rayinfo->MaxPointsPerRay, org, params.Bdry, params.bdinfo,
-            params.refl, params.ssp, params.Pos, params.Angles, params.freqinfo,
-            params.Beam, params.sbp, errState);
+            rinit, ray, Nsteps, rayinfo->MaxPointsPerRay, capacity, grow, org,
+            params.Bdry, params.bdinfo, params.refl, params.ssp, params.Pos,
+            params.Angles, params.freqinfo, params.Beam, params.sbp, srcCache, errState);
     } else if(st == 'P') {
         MainRayMode<CfgSel<'R', 'G', 'P'>, O3D, R3D>(
-            rinit, ray, Nsteps, rayinfo->MaxPointsPerRay, org, params.Bdry, params.bdinfo,
-            params.refl, params.ssp, params.Pos, params.Angles, params.freqinfo,
-            params.Beam, params.sbp, errState);
+            rinit, ray, Nsteps, rayinfo->MaxPointsPerRay, capacity, grow, org,
+            params.Bdry, params.bdinfo, params.refl, params.ssp, params.Pos,
+            params.Angles, params.freqinfo, params.Beam, params.sbp, srcCache, errState);
     } else if(st == 'Q') {
         MainRayMode<CfgSel<'R', 'G', 'Q'>, O3D, R3D>(
-            rinit, ray, Nsteps, rayinfo->MaxPointsPerRay, org, params.Bdry, params.bdinfo,
-            params.refl, params.ssp, params.Pos, params.Angles, params.freqinfo,
-            params.Beam, params.sbp, errState);
+            rinit, ray, Nsteps, rayinfo->MaxPointsPerRay, capacity, grow, org,
+            params.Bdry, params.bdinfo, params.refl, params.ssp, params.Pos,
+            params.Angles, params.freqinfo, params.Beam, params.sbp, srcCache, errState);
     } else if(st == 'H') {
         MainRayMode<CfgSel<'R', 'G', 'H'>, O3D, R3D>(
-            rinit, ray, Nsteps, rayinfo->MaxPointsPerRay, org, params.Bdry, params.bdinfo,
-            params.refl, params.ssp, params.Pos, params.Angles, params.freqinfo,
-            params.Beam, params.sbp, errState);
+            rinit, ray, Nsteps, rayinfo->MaxPointsPerRay, capacity, grow, org,
+            params.Bdry, params.bdinfo, params.refl, params.ssp, params.Pos,
+            params.Angles, params.freqinfo, params.Beam, params.sbp, srcCache, errState);
     } else if(st == 'A') {
         MainRayMode<CfgSel<'R', 'G', 'A'>, O3D, R3D>(
-            rinit, ray, Nsteps, rayinfo->MaxPointsPerRay, org, params.Bdry, params.bdinfo,
-            params.refl, params.ssp, params.Pos, params.Angles, params.freqinfo,
-            params.Beam, params.sbp, errState);
+            rinit, ray, Nsteps, rayinfo->MaxPointsPerRay, capacity, grow, org,
+            params.Bdry, params.bdinfo, params.refl, params.ssp, params.Pos,
+            params.Angles, params.freqinfo, params.Beam, params.sbp, srcCache, errState);
     } else {
         RunError(errState, BHC_ERR_INVALID_SSP_TYPE);
         return false;
     }
+    if(outOfMemory) {
+        if(!rayinfo->isRayFan) RunWarning(errState, BHC_WARN_RAYS_OUTOFMEMORY);
+        rayinfo->results[job].ray = nullptr;
+        return false;
+    }
     if(HasErrored(errState)) return false;
 
     bool ret = true;
-    if(rayinfo->isCopyMode) {
+    if(rayinfo->isStreamOnly) {
+        // LP: Nothing is kept; the work ray is reused for the next ray.
+        RayResult<O3D, R3D> streamed;
+        streamed.ray          = ray;
+        streamed.org          = org;
+        streamed.SrcDeclAngle = rinit.SrcDeclAngle;
+        streamed.Nsteps       = Nsteps;
+        GetInternal(params)->rayCallback(job, &streamed);
+        rayinfo->results[job].ray = nullptr;
+        return true;
+    } else if(rayinfo->isCopyMode) {
         size_t p = AtomicFetchAdd(&rayinfo->RayMemPoints, (size_t)Nsteps);
         if(p + (size_t)Nsteps > rayinfo->RayMemCapacity) {
             RunWarning(errState, BHC_WARN_RAYS_OUTOFMEMORY);
@@ -98,53 +159,61 @@ template<bool O3D, bool R3D> bool RunRay(
         }
     } else {
         rayinfo->results[job].ray = ray;
+        chunk->begin              = (size_t)(ray - rayinfo->RayMem) + (size_t)Nsteps;
     }
     rayinfo->results[job].org          = org;
     rayinfo->results[job].SrcDeclAngle = rinit.SrcDeclAngle;
     rayinfo->results[job].Nsteps       = Nsteps;
 
+    if(ret && !rayinfo->isRayFan && GetInternal(params)->rayCallback != nullptr) {
+        GetInternal(params)->rayCallback(job, &rayinfo->results[job]);
+    }
     return ret;
 }
 
 #if BHC_ENABLE_2D
 template bool RunRay<false, false>(
     RayInfo<false, false> *rayinfo, const bhcParams<false> &params, int32_t job,
-    int32_t worker, RayInitInfo &rinit, int32_t &Nsteps, ErrState *errState);
+    int32_t worker, RayInitInfo &rinit, int32_t &Nsteps,
+    RaySourceCache<false> *srcCache, ErrState *errState);
 #endif
 #if BHC_ENABLE_NX2D
 template bool RunRay<true, false>(
     RayInfo<true, false> *rayinfo, const bhcParams<true> &params, int32_t job,
-    int32_t worker, RayInitInfo &rinit, int32_t &Nsteps, ErrState *errState);
+    int32_t worker, RayInitInfo &rinit, int32_t &Nsteps,
+    RaySourceCache<true> *srcCache, ErrState *errState);
 #endif
 #if BHC_ENABLE_3D
 template bool RunRay<true, true>(
     RayInfo<true, true> *rayinfo, const bhcParams<true> &params, int32_t job,
-    int32_t worker, RayInitInfo &rinit, int32_t &Nsteps, ErrState *errState);
+    int32_t worker, RayInitInfo &rinit, int32_t &Nsteps,
+    RaySourceCache<true> *srcCache, ErrState *errState);
 #endif
 
 template<bool O3D, bool R3D> void RayModeWorker(
     const bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs, int32_t worker,
     ErrState *errState)
 {
-    SetupThread();
-    while(true) {
-        int32_t job    = GetInternal(params)->sharedJobID++;
-        int32_t Nsteps = -1;
-        RayInitInfo rinit;
-        if(!GetJobIndices<O3D>(rinit, job, params.Pos, params.Angles)) break;
-        if(!RunRay<O3D, R3D>(
-               outputs.rayinfo, params, job, worker, rinit, Nsteps, errState)) {
-            break;
-        }
-        GetInternal(params)->completedRayCount++;
-    }
-
-    GetInternal(params)->activeThreadCount--;
-    if(GetInternal(params)->activeThreadCount == 0) {
-        if(GetInternal(params)->completedCallback != nullptr) {
-            GetInternal(params)->completedCallback();
+    JobScheduler &jobScheduler = GetInternal(params)->jobScheduler;
+    Progress &progress         = GetInternal(params)->progress;
+    RaySourceCache<O3D> srcCache;
+    InitRaySourceCache(&srcCache);
+    int32_t job, jobEnd;
+    bool going = true;
+    while(going && jobScheduler.Next(worker, job, jobEnd)) {
+        int32_t jobStart = job;
+        for(; job < jobEnd; ++job) {
+            int32_t Nsteps = -1;
+            RayInitInfo rinit;
+            if(!GetJobIndices<O3D>(rinit, job, params.Pos, params.Angles)
+               || !RunRay<O3D, R3D>(
+                   outputs.rayinfo, params, job, worker, rinit, Nsteps, &srcCache,
+                   errState)) {
+                going = false;
+                break;
+            }
         }
-        CheckReportErrors(GetInternal(params), errState);
+        progress.Add(job - jobStart);
     }
 }
 
@@ -167,23 +236,16 @@ template void RayModeWorker<true, true>(
 template<bool O3D, bool R3D> void RunRayMode(
     bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs)
 {
-    ResetErrState(&GetInternal(params)->errState);
-    GetInternal(params)->sharedJobID       = 0;
-    int32_t numThreads                     = GetInternal(params)->numThreads;
-    GetInternal(params)->totalJobs         = GetNumJobs<O3D>(params.Pos, params.Angles);
-    GetInternal(params)->activeThreadCount = numThreads;
-    std::vector<std::thread> threads;
-    for(int32_t i = 0; i < numThreads; ++i)
-        threads.push_back(std::thread(
-            RayModeWorker<O3D, R3D>, std::ref(params), std::ref(outputs), i,
-            &GetInternal(params)->errState));
-    for(int32_t i = 0; i < numThreads; ++i) {
-        if(outputs.rayinfo->blocking) {
-            threads[i].join();
-        } else {
-            threads[i].detach();
-        }
+    ErrState errState;
+    ResetErrState(&errState);
+    GetInternal(params)->jobScheduler.Reset(GetNumJobs<O3D>(params.Pos, params.Angles));
+    {
+        CancelScope cancelScope(GetInternal(params), &errState);
+        GetInternal(params)->threadPool.Run([&](int32_t worker) {
+            RayModeWorker<O3D, R3D>(params, outputs, worker, &errState);
+        });
     }
+    CheckReportErrors(GetInternal(params), &errState);
 }
 
 #if BHC_ENABLE_2D
@@ -199,6 +261,243 @@ template void RunRayMode<true, true>(
     bhcParams<true> &params, bhcOutputs<true, true> &outputs);
 #endif
 
+/**
+ * Magic number at the start of a binary .ray file (bhcInit::binaryRayFile).
+ * Text .ray files start with the quoted title, so they never match it.
+ */
+constexpr char BinaryRayMagic[8] = {'B', 'H', 'C', 'R', 'A', 'Y', 'B', '1'};
+/**
+ * Bytes of binary ray data assembled in memory before each write to the file.
+ */
+constexpr size_t RayWriteChunkBytes = size_t(16) << 20;
+
+template<bool O3D> inline void CheckRayFileHeader(
+    const bhcParams<O3D> &params, int32_t NSx, int32_t NSy, int32_t NSz, int32_t alphaN,
+    int32_t betaN, real TopDepth, real BotDepth)
+{
+    if(NSx != params.Pos->NSx || NSy != params.Pos->NSy || NSz != params.Pos->NSz) {
+        EXTWARN(
+            "NSx = %d, NSy = %d, NSz = %d in RAYFile being loaded, but "
+            "%d, %d, %d in env file",
+            NSx, NSy, NSz, params.Pos->NSx, params.Pos->NSy, params.Pos->NSz);
+    }
+    if(alphaN != params.Angles->alpha.n) {
+        EXTWARN(
+            "Warning, RAYFile has alphaN = %d, but env file has %d", alphaN,
+            params.Angles->alpha.n);
+    }
+    if(betaN != params.Angles->beta.n) {
+        EXTWARN(
+            "Warning, RAYFile has betaN = %d, but env file has %d", betaN,
+            params.Angles->beta.n);
+    }
+    if(TopDepth != params.Bdry->Top.hs.Depth) {
+        EXTWARN(
+            "Warning, RAYFile has top depth = %f, but env file has %f", TopDepth,
+            params.Bdry->Top.hs.Depth);
+    }
+    if(BotDepth != params.Bdry->Bot.hs.Depth) {
+        EXTWARN(
+            "Warning, RAYFile has bot depth = %f, but env file has %f", BotDepth,
+            params.Bdry->Bot.hs.Depth);
+    }
+}
+
+/**
+ * LP: Binary version of the .ray file. All values are native-endian:
+ * magic (8 bytes), sizeof(real) and number of coordinates per point (int32 x2),
+ * title (char[80]), freq0 (real), NSx, NSy, NSz, alphaN, betaN (int32 x5),
+ * top and bottom depth (real x2), number of rays (int32) and total number of
+ * points (int64). Then for each ray: SrcDeclAngle (real, same units as the text
+ * format), Nsteps, NumTopBnc, NumBotBnc (int32 x3), and Nsteps points in ocean
+ * coordinates (real x2 or x3 each). The counts in the header let the reader
+ * allocate everything up front and read the file in one pass.
+ */
+template<bool O3D, bool R3D> void WriteOutRayBinary(
+    const bhcParams<O3D> &params, const bhcOutputs<O3D, R3D> &outputs)
+{
+    const RayInfo<O3D, R3D> *rayinfo = outputs.rayinfo;
+    if(!IsRayRun(params.Beam) && !IsEigenraysRun(params.Beam)
+       && !IsAlsoEigenraysRun(params.Beam)) {
+        EXTERR("WriteOutRayBinary not in ray trace or eigenrays mode");
+    }
+    std::ofstream RAYFile(GetInternal(params)->FileRoot + ".ray", std::ios::binary);
+    if(!RAYFile.is_open()) EXTERR("Could not open binary RAYFile for writing");
+
+    // LP: Everything is assembled into a large buffer and written in big
+    // sequential blocks, rather than one small write per value.
+    std::vector<char> buf;
+    buf.reserve(RayWriteChunkBytes);
+    auto put = [&](const void *data, size_t bytes) {
+        const char *d = (const char *)data;
+        buf.insert(buf.end(), d, d + bytes);
+        if(buf.size() >= RayWriteChunkBytes) {
+            RAYFile.write(buf.data(), buf.size());
+            buf.clear();
+        }
+    };
+
+    int32_t NRays       = 0;
+    int64_t TotalPoints = 0;
+    for(int32_t r = 0; r < rayinfo->NRays; ++r) {
+        if(rayinfo->results[r].ray == nullptr) continue;
+        ++NRays;
+        TotalPoints += rayinfo->results[r].Nsteps;
+    }
+
+    int32_t format[2] = {(int32_t)sizeof(real), O3D ? 3 : 2};
+    int32_t counts[5] = {params.Pos->NSx, params.Pos->NSy, params.Pos->NSz,
+                         params.Angles->alpha.n, params.Angles->beta.n};
+    real depths[2]    = {params.Bdry->Top.hs.Depth, params.Bdry->Bot.hs.Depth};
+    put(BinaryRayMagic, sizeof(BinaryRayMagic));
+    put(format, sizeof(format));
+    put(params.Title, sizeof(params.Title));
+    put(&params.freqinfo->freq0, sizeof(real));
+    put(counts, sizeof(counts));
+    put(depths, sizeof(depths));
+    put(&NRays, sizeof(NRays));
+    put(&TotalPoints, sizeof(TotalPoints));
+
+    Progress &progress = GetInternal(params)->progress;
+    progress.SetUnits(rayinfo->NRays);
+    for(int32_t r = 0; r < rayinfo->NRays; ++r) {
+        progress.Add(1);
+        const RayResult<O3D, R3D> *res = &rayinfo->results[r];
+        if(res->ray == nullptr) continue;
+        // take-off angle of this ray [LP: 2D: degrees, 3D: radians]
+        real alpha0 = res->SrcDeclAngle;
+        if constexpr(O3D) alpha0 *= DegRad;
+        int32_t raycounts[3] = {res->Nsteps, res->ray[res->Nsteps - 1].NumTopBnc,
+                                res->ray[res->Nsteps - 1].NumBotBnc};
+        put(&alpha0, sizeof(alpha0));
+        put(raycounts, sizeof(raycounts));
+        for(int32_t is = 0; is < res->Nsteps; ++is) {
+            VEC23<O3D> v = RayToOceanX(res->ray[is].x, res->org);
+            put(&v, sizeof(v));
+        }
+    }
+    RAYFile.write(buf.data(), buf.size());
+    if(!RAYFile.good()) EXTERR("Failed to write binary RAYFile");
+}
+
+#if BHC_ENABLE_2D
+template void WriteOutRayBinary<false, false>(
+    const bhcParams<false> &params, const bhcOutputs<false, false> &outputs);
+#endif
+#if BHC_ENABLE_NX2D
+template void WriteOutRayBinary<true, false>(
+    const bhcParams<true> &params, const bhcOutputs<true, false> &outputs);
+#endif
+#if BHC_ENABLE_3D
+template void WriteOutRayBinary<true, true>(
+    const bhcParams<true> &params, const bhcOutputs<true, true> &outputs);
+#endif
+
+/**
+ * Reads a binary .ray file (see WriteOutRayBinary) in a single pass. RAYFile is
+ * positioned just after the magic number.
+ */
+template<bool O3D, bool R3D> void ReadOutRayBinary(
+    bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs, std::ifstream &RAYFile)
+{
+    RayInfo<O3D, R3D> *rayinfo = outputs.rayinfo;
+
+    auto get = [&](void *data, size_t bytes) {
+        RAYFile.read((char *)data, bytes);
+        if(!RAYFile.good()) EXTERR("Binary RAYFile is truncated or unreadable");
+    };
+
+    int32_t format[2];
+    get(format, sizeof(format));
+    if(format[0] != (int32_t)sizeof(real)) {
+        EXTERR(
+            "Binary RAYFile was written with %d-byte reals, but this build uses %d",
+            format[0], (int32_t)sizeof(real));
+    }
+    if(format[1] != (O3D ? 3 : 2)) {
+        EXTERR(
+            "Binary RAYFile has %d coordinates per point, must be %d", format[1],
+            O3D ? 3 : 2);
+    }
+
+    char TempTitle[sizeof(params.Title)];
+    get(TempTitle, sizeof(TempTitle));
+    bhc::module::Title<O3D> title;
+    title.SetTitle(params, std::string(TempTitle, strnlen(TempTitle, sizeof(TempTitle))));
+    get(&params.freqinfo->freq0, sizeof(real));
+
+    int32_t counts[5];
+    real depths[2];
+    get(counts, sizeof(counts));
+    get(depths, sizeof(depths));
+    CheckRayFileHeader(
+        params, counts[0], counts[1], counts[2], counts[3], counts[4], depths[0],
+        depths[1]);
+
+    int32_t NRays;
+    int64_t TotalPoints;
+    get(&NRays, sizeof(NRays));
+    get(&TotalPoints, sizeof(TotalPoints));
+    if(NRays < 0 || TotalPoints < (int64_t)NRays) {
+        EXTERR("Invalid number of rays or points in binary RAYFile");
+    }
+
+    trackdeallocate(params, rayinfo->RayMem);
+    trackdeallocate(params, rayinfo->WorkRayMem);
+    rayinfo->NRays        = NRays;
+    rayinfo->RayMemPoints = rayinfo->RayMemCapacity = (size_t)TotalPoints;
+    rayinfo->MaxPointsPerRay                        = MaxN;
+    trackallocate(params, "ray metadata", rayinfo->results, rayinfo->NRays);
+    trackallocate(params, "rays", rayinfo->RayMem, rayinfo->RayMemCapacity);
+    memset(rayinfo->results, 0, rayinfo->NRays * sizeof(RayResult<O3D, R3D>));
+    memset(rayinfo->RayMem, 0, rayinfo->RayMemCapacity * sizeof(rayPt<R3D>));
+
+    std::vector<VEC23<O3D>> points;
+    size_t p = 0;
+    for(int32_t r = 0; r < NRays; ++r) {
+        RayResult<O3D, R3D> *res = &rayinfo->results[r];
+        real alpha0;
+        int32_t raycounts[3];
+        get(&alpha0, sizeof(alpha0));
+        get(raycounts, sizeof(raycounts));
+        int32_t Nsteps = raycounts[0];
+        if(Nsteps <= 0 || p + (size_t)Nsteps > (size_t)TotalPoints) {
+            EXTERR("Invalid number of points in ray in binary RAYFile");
+        }
+        if(raycounts[1] < 0 || raycounts[2] < 0) {
+            EXTERR("Invalid number of bounces in ray in binary RAYFile");
+        }
+        if constexpr(O3D) alpha0 *= RadDeg;
+        res->SrcDeclAngle = alpha0;
+        res->Nsteps       = Nsteps;
+        res->ray          = &rayinfo->RayMem[p];
+        p += (size_t)Nsteps;
+
+        points.resize(Nsteps);
+        get(points.data(), (size_t)Nsteps * sizeof(VEC23<O3D>));
+
+        VEC23<R3D> t(RL(0.0));
+        if constexpr(O3D && !R3D) {
+            res->org.xs = points[0];
+            t           = XYCOMP(points[Nsteps - 1] - points[0]);
+            t *= RL(1.0) / glm::length(t);
+            res->org.tradial = t;
+        }
+        res->ray[Nsteps - 1].NumTopBnc = raycounts[1];
+        res->ray[Nsteps - 1].NumBotBnc = raycounts[2];
+
+        ErrState errState;
+        ResetErrState(&errState);
+        for(int32_t is = 0; is < Nsteps; ++is) {
+            res->ray[is].x = OceanToRayX(points[is], res->org, t, -1, &errState);
+        }
+        CheckReportErrors(GetInternal(params), &errState);
+    }
+    if(p != (size_t)TotalPoints) {
+        EXTERR("Number of points in binary RAYFile does not match header");
+    }
+}
+
 template<bool O3D, bool R3D> void ReadOutRay(
     bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs, const char *FileRoot)
 {
@@ -206,6 +505,15 @@ template<bool O3D, bool R3D> void ReadOutRay(
     if(!IsRayRun(params.Beam) && !IsEigenraysRun(params.Beam)) {
         EXTERR("ReadOutRay not in ray trace or eigenrays mode");
     }
+    {
+        std::ifstream BinRAYFile(std::string(FileRoot) + ".ray", std::ios::binary);
+        char magic[sizeof(BinaryRayMagic)];
+        if(BinRAYFile.read(magic, sizeof(magic))
+           && memcmp(magic, BinaryRayMagic, sizeof(magic)) == 0) {
+            ReadOutRayBinary<O3D, R3D>(params, outputs, BinRAYFile);
+            return;
+        }
+    }
     LDIFile RAYFile(GetInternal(params), std::string(FileRoot) + ".ray");
 
     std::string TempTitle;
@@ -222,42 +530,17 @@ template<bool O3D, bool R3D> void ReadOutRay(
     RAYFile.Read(NSx);
     RAYFile.Read(NSy);
     RAYFile.Read(NSz);
-    if(NSx != params.Pos->NSx || NSy != params.Pos->NSy || NSz != params.Pos->NSz) {
-        EXTWARN(
-            "NSx = %d, NSy = %d, NSz = %d in RAYFile being loaded, but "
-            "%d, %d, %d in env file",
-            NSx, NSy, NSz, params.Pos->NSx, params.Pos->NSy, params.Pos->NSz);
-    }
 
     int32_t alphaN, betaN;
     LIST(RAYFile);
     RAYFile.Read(alphaN);
     RAYFile.Read(betaN);
-    if(alphaN != params.Angles->alpha.n) {
-        EXTWARN(
-            "Warning, RAYFile has alphaN = %d, but env file has %d", alphaN,
-            params.Angles->alpha.n);
-    }
-    if(betaN != params.Angles->beta.n) {
-        EXTWARN(
-            "Warning, RAYFile has betaN = %d, but env file has %d", betaN,
-            params.Angles->beta.n);
-    }
 
     real TopDepth, BotDepth;
     LIST(RAYFile);
     RAYFile.Read(TopDepth);
     RAYFile.Read(BotDepth);
-    if(TopDepth != params.Bdry->Top.hs.Depth) {
-        EXTWARN(
-            "Warning, RAYFile has top depth = %f, but env file has %f", TopDepth,
-            params.Bdry->Top.hs.Depth);
-    }
-    if(BotDepth != params.Bdry->Bot.hs.Depth) {
-        EXTWARN(
-            "Warning, RAYFile has bot depth = %f, but env file has %f", BotDepth,
-            params.Bdry->Bot.hs.Depth);
-    }
+    CheckRayFileHeader(params, NSx, NSy, NSz, alphaN, betaN, TopDepth, BotDepth);
 
     std::string dim;
     LIST(RAYFile);
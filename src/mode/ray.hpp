@@ -22,18 +22,28 @@ this program. If not, see <https://www.gnu.org/licenses/>.
 
 namespace bhc { namespace mode {
 
+/**
+ * Points of RayMem a worker takes at a time when not in copy mode. A ray which
+ * needs more than is left in the chunk moves to a new chunk of twice its size.
+ */
+constexpr size_t RayMemChunkPoints = 4096;
+
 template<bool O3D, bool R3D> bool RunRay(
     RayInfo<O3D, R3D> *rayinfo, const bhcParams<O3D> &params, int32_t job, int32_t worker,
-    RayInitInfo &rinit, int32_t &Nsteps, ErrState *errState);
+    RayInitInfo &rinit, int32_t &Nsteps, RaySourceCache<O3D> *srcCache,
+    ErrState *errState);
 extern template bool RunRay<false, false>(
     RayInfo<false, false> *rayinfo, const bhcParams<false> &params, int32_t job,
-    int32_t worker, RayInitInfo &rinit, int32_t &Nsteps, ErrState *errState);
+    int32_t worker, RayInitInfo &rinit, int32_t &Nsteps,
+    RaySourceCache<false> *srcCache, ErrState *errState);
 extern template bool RunRay<true, false>(
     RayInfo<true, false> *rayinfo, const bhcParams<true> &params, int32_t job,
-    int32_t worker, RayInitInfo &rinit, int32_t &Nsteps, ErrState *errState);
+    int32_t worker, RayInitInfo &rinit, int32_t &Nsteps,
+    RaySourceCache<true> *srcCache, ErrState *errState);
 extern template bool RunRay<true, true>(
     RayInfo<true, true> *rayinfo, const bhcParams<true> &params, int32_t job,
-    int32_t worker, RayInitInfo &rinit, int32_t &Nsteps, ErrState *errState);
+    int32_t worker, RayInitInfo &rinit, int32_t &Nsteps,
+    RaySourceCache<true> *srcCache, ErrState *errState);
 
 template<bool O3D, bool R3D> void RunRayMode(
     bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs);
@@ -44,6 +54,15 @@ extern template void RunRayMode<true, false>(
 extern template void RunRayMode<true, true>(
     bhcParams<true> &params, bhcOutputs<true, true> &outputs);
 
+template<bool O3D, bool R3D> void WriteOutRayBinary(
+    const bhcParams<O3D> &params, const bhcOutputs<O3D, R3D> &outputs);
+extern template void WriteOutRayBinary<false, false>(
+    const bhcParams<false> &params, const bhcOutputs<false, false> &outputs);
+extern template void WriteOutRayBinary<true, false>(
+    const bhcParams<true> &params, const bhcOutputs<true, false> &outputs);
+extern template void WriteOutRayBinary<true, true>(
+    const bhcParams<true> &params, const bhcOutputs<true, true> &outputs);
+
 template<bool O3D, bool R3D> void ReadOutRay(
     bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs, const char *FileRoot);
 extern template void ReadOutRay<false, false>(
@@ -60,61 +79,41 @@ public:
 
     virtual void Init(bhcOutputs<O3D, R3D> &outputs) const override
     {
-        outputs.rayinfo->results    = nullptr;
-        outputs.rayinfo->RayMem     = nullptr;
-        outputs.rayinfo->WorkRayMem = nullptr;
+        outputs.rayinfo->results      = nullptr;
+        outputs.rayinfo->RayMem       = nullptr;
+        outputs.rayinfo->WorkRayMem   = nullptr;
+        outputs.rayinfo->WorkerChunks = nullptr;
 
         outputs.rayinfo->RayMemCapacity  = 0;
         outputs.rayinfo->RayMemPoints    = 0;
         outputs.rayinfo->MaxPointsPerRay = 0;
         outputs.rayinfo->NRays           = 0;
+        outputs.rayinfo->isCopyMode      = false;
+        outputs.rayinfo->isStreamOnly    = false;
+        outputs.rayinfo->isRayFan        = false;
+        outputs.rayinfo->fanTraced       = false;
+        outputs.rayinfo->fanKey          = 0;
+        // LP: rayinfo is allocated with trackallocate, so the default member
+        // initializer does not apply.
+        outputs.rayinfo->blocking = true;
     }
 
     virtual void Preprocess(
         bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs) const override
     {
-        RayInfo<O3D, R3D> *rayinfo = outputs.rayinfo;
-
-        trackdeallocate(params, rayinfo->RayMem);
-        trackdeallocate(params, rayinfo->WorkRayMem);
-        rayinfo->NRays = IsEigenraysRun(params.Beam) || IsAlsoEigenraysRun(params.Beam)
-            ? outputs.eigen->neigen
-            : GetNumJobs<O3D>(params.Pos, params.Angles);
-        trackallocate(params, "ray metadata", rayinfo->results, rayinfo->NRays);
-        // Clear because will check pointers
-        memset(rayinfo->results, 0, rayinfo->NRays * sizeof(RayResult<O3D, R3D>));
+        AllocateRays(params, outputs, GetInternal(params)->maxMemory, false);
+    }
 
-        rayinfo->MaxPointsPerRay = MaxN;
-        rayinfo->isCopyMode      = false;
-        size_t needtotalsize = (size_t)rayinfo->NRays * (size_t)MaxN * sizeof(rayPt<R3D>);
-        if(GetInternal(params)->usedMemory + needtotalsize
-           <= GetInternal(params)->maxMemory) {
-            rayinfo->RayMemCapacity = (size_t)rayinfo->NRays * (size_t)MaxN;
-        } else if(GetInternal(params)->useRayCopyMode) {
-            trackallocate(
-                params, "work rays for copy mode", rayinfo->WorkRayMem,
-                GetInternal(params)->numThreads * MaxN);
-            rayinfo->RayMemCapacity = (GetInternal(params)->maxMemory
-                                       - GetInternal(params)->usedMemory)
-                / sizeof(rayPt<R3D>);
-            rayinfo->isCopyMode = true;
-        } else {
-            rayinfo->MaxPointsPerRay = (int32_t)std::min(
-                (GetInternal(params)->maxMemory - GetInternal(params)->usedMemory)
-                    / ((size_t)rayinfo->NRays * sizeof(rayPt<R3D>)),
-                (size_t)0x7FFFFFFF);
-            if(rayinfo->MaxPointsPerRay == 0) {
-                EXTERR("Insufficient memory to allocate any rays at all");
-            } else if(rayinfo->MaxPointsPerRay < 500) {
-                EXTWARN(
-                    "There is only enough memory to allocate %d points per ray",
-                    rayinfo->MaxPointsPerRay);
-            }
-            rayinfo->RayMemCapacity = (size_t)rayinfo->NRays
-                * (size_t)rayinfo->MaxPointsPerRay;
-        }
-        trackallocate(params, "rays", rayinfo->RayMem, rayinfo->RayMemCapacity);
-        rayinfo->RayMemPoints = 0;
+    /**
+     * Allocates the ray fan of a TL or arrivals run (see bhcInit::reuseRayFan),
+     * using memory up to maxMemory (total, like bhcInit::maxMemory). If there
+     * is not enough for any rays, warns and leaves isRayFan false, and the run
+     * traces its rays as usual.
+     */
+    void PreprocessFan(
+        bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs, size_t maxMemory) const
+    {
+        AllocateRays(params, outputs, maxMemory, true);
     }
 
     virtual void Run(bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs) const override
@@ -136,10 +135,17 @@ public:
     virtual void Writeout(
         const bhcParams<O3D> &params, const bhcOutputs<O3D, R3D> &outputs) const override
     {
+        if(GetInternal(params)->binaryRayFile) {
+            WriteOutRayBinary<O3D, R3D>(params, outputs);
+            return;
+        }
         RayInfo<O3D, R3D> *rayinfo = outputs.rayinfo;
+        Progress &progress         = GetInternal(params)->progress;
         LDOFile RAYFile;
         OpenRAYFile(RAYFile, GetInternal(params)->FileRoot, params);
+        progress.SetUnits(rayinfo->NRays);
         for(int r = 0; r < rayinfo->NRays; ++r) {
+            progress.Add(1);
             const RayResult<O3D, R3D> *res = &rayinfo->results[r];
             if(res->ray == nullptr) continue;
             WriteRay(RAYFile, res);
@@ -159,12 +165,81 @@ public:
         trackdeallocate(params, outputs.rayinfo->results);
         trackdeallocate(params, outputs.rayinfo->RayMem);
         trackdeallocate(params, outputs.rayinfo->WorkRayMem);
+        trackdeallocate(params, outputs.rayinfo->WorkerChunks);
     }
 
 private:
     // LP: These are small enough that it's not really necessary to compile
     // them separately.
 
+    inline void AllocateRays(
+        bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs, size_t maxMemory,
+        bool fan) const
+    {
+        RayInfo<O3D, R3D> *rayinfo = outputs.rayinfo;
+
+        trackdeallocate(params, rayinfo->RayMem);
+        trackdeallocate(params, rayinfo->WorkRayMem);
+        trackdeallocate(params, rayinfo->WorkerChunks);
+        rayinfo->NRays = IsEigenraysRun(params.Beam) || IsAlsoEigenraysRun(params.Beam)
+            ? outputs.eigen->neigen
+            : GetNumJobs<O3D>(params.Pos, params.Angles);
+        trackallocate(params, "ray metadata", rayinfo->results, rayinfo->NRays);
+        // Clear because will check pointers
+        memset(rayinfo->results, 0, rayinfo->NRays * sizeof(RayResult<O3D, R3D>));
+
+        rayinfo->MaxPointsPerRay = MaxN;
+        rayinfo->isCopyMode      = false;
+        rayinfo->isStreamOnly    = false;
+        rayinfo->isRayFan        = false;
+        rayinfo->fanTraced       = false;
+        int32_t numThreads       = GetInternal(params)->numThreads;
+        size_t needtotalsize = (size_t)rayinfo->NRays * (size_t)MaxN * sizeof(rayPt<R3D>);
+        if(!fan && GetInternal(params)->rayCallback != nullptr
+           && !GetInternal(params)->keepStreamedRays) {
+            // LP: Like copy mode, but the rays are only passed to rayCallback
+            // from the work rays, and not copied anywhere.
+            trackallocate(
+                params, "work rays for streaming", rayinfo->WorkRayMem,
+                numThreads * MaxN);
+            rayinfo->RayMemCapacity = 0;
+            rayinfo->isCopyMode     = true;
+            rayinfo->isStreamOnly   = true;
+            rayinfo->RayMemPoints   = 0;
+            return;
+        } else if(
+            !fan && GetInternal(params)->usedMemory + needtotalsize > maxMemory
+            && GetInternal(params)->useRayCopyMode) {
+            trackallocate(
+                params, "work rays for copy mode", rayinfo->WorkRayMem,
+                numThreads * MaxN);
+            rayinfo->RayMemCapacity = (maxMemory - GetInternal(params)->usedMemory)
+                / sizeof(rayPt<R3D>);
+            rayinfo->isCopyMode = true;
+        } else {
+            // LP: Each ray only uses as much of RayMem as it needs (see
+            // RunRay), so there is no need to limit the length of each ray;
+            // if the rays do not all fit, the ones which do not are dropped.
+            trackallocate(params, "ray chunks", rayinfo->WorkerChunks, numThreads);
+            memset(rayinfo->WorkerChunks, 0, numThreads * sizeof(RayMemChunk));
+            // Padding used by trackallocate
+            size_t used = GetInternal(params)->usedMemory + 32;
+            size_t mem  = maxMemory > used ? maxMemory - used : 0;
+            rayinfo->RayMemCapacity = std::min(
+                (size_t)rayinfo->NRays * (size_t)MaxN + numThreads * RayMemChunkPoints,
+                mem / sizeof(rayPt<R3D>));
+            if(rayinfo->RayMemCapacity < 3) {
+                if(!fan) EXTERR("Insufficient memory to allocate any rays at all");
+                EXTWARN("Insufficient memory for the ray fan, rays will not be kept");
+                trackdeallocate(params, rayinfo->WorkerChunks);
+                return;
+            }
+        }
+        trackallocate(params, "rays", rayinfo->RayMem, rayinfo->RayMemCapacity);
+        rayinfo->RayMemPoints = 0;
+        rayinfo->isRayFan     = fan;
+    }
+
     inline void OpenRAYFile(
         LDOFile &RAYFile, std::string FileRoot, const bhcParams<O3D> &params) const
     {
@@ -34,10 +34,12 @@ namespace bhc { namespace mode {
  * atten: stabilizing attenuation (for wavenumber integration only)
  * PlotType: If "TL", writes only first and last Sx and Sy [LP: never set to
  * "TL" in BELLHOP]
+ * cpxfRecords: LP: Make the record length a multiple of sizeof(cpxf), so the
+ * data records can be used in place as arrays of cpxf (mapped TL file)
  */
 template<bool O3D> inline void WriteHeader(
     const bhcParams<O3D> &params, DirectOFile &SHDFile, float atten,
-    const std::string &PlotType)
+    const std::string &PlotType, bool cpxfRecords = false)
 {
     const Position *Pos      = params.Pos;
     const FreqInfo *freqinfo = params.freqinfo;
@@ -53,6 +55,10 @@ template<bool O3D> inline void WriteHeader(
     LRecl = bhc::max(LRecl, Pos->NSz * (int32_t)sizeof(Pos->Sz[0]));
     LRecl = bhc::max(LRecl, Pos->NRz * (int32_t)sizeof(Pos->Rz[0]));
     LRecl = bhc::max(LRecl, Pos->NRr * (int32_t)sizeof(cpxf));
+    if(cpxfRecords) {
+        LRecl = (LRecl + (int32_t)sizeof(cpxf) - 1) / (int32_t)sizeof(cpxf)
+            * (int32_t)sizeof(cpxf);
+    }
 
     std::string FileName = GetInternal(params)->FileRoot + ".shd";
     SHDFile.open(FileName, LRecl);
@@ -100,19 +106,114 @@ template<bool O3D> inline void WriteHeader(
     DOFWRITE(SHDFile, Pos->Rr, Pos->NRr * sizeof(Pos->Rr[0]));
 }
 
+template<bool O3D, bool R3D> void AllocateTL(
+    bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs, bool mapFile)
+{
+    FreeTL<O3D, R3D>(params, outputs); // Free if previously run
+    Position *Pos  = params.Pos;
+    Pos->TLRecCpxf = 0;
+    // LP: Without broadbandTL, the field is only computed at freq0, as in
+    // BELLHOP(3D), even if there is a frequency vector.
+    FreqInfo *freqinfo = params.freqinfo;
+    freqinfo->NfreqTL  = GetInternal(params)->broadbandTL ? freqinfo->Nfreq : 1;
+#ifdef BHC_BUILD_CUDA
+    mapFile = false;
+#endif
+    if(!mapFile) {
+        size_t n = GetTLFieldSize(Pos, freqinfo);
+        trackallocate(params, "sound field / transmission loss", outputs.uAllSources, n);
+        memset(outputs.uAllSources, 0, n * sizeof(cpxf));
+        return;
+    }
+
+    // LP: Write the header records, then map the whole file including them, so
+    // the data records are accumulated in place. The rest of the file starts
+    // out as zeros.
+    size_t recl;
+    {
+        DirectOFile SHDFile(GetInternal(params));
+        WriteHeader(
+            params, SHDFile, 0.0f,
+            IsIrregularGrid(params.Beam) ? "irregular " : "rectilin  ", true);
+        recl = SHDFile.reclen();
+    }
+    size_t NRecs = (size_t)Pos->NSx * (size_t)Pos->NSy * (size_t)freqinfo->NfreqTL
+        * (size_t)Pos->Ntheta * (size_t)Pos->NSz * (size_t)Pos->NRz_per_range;
+    std::string FileName = GetInternal(params)->FileRoot + ".shd";
+    MappedFile &tlFile   = GetInternal(params)->tlFile;
+    if(!tlFile.Open(FileName, (10 + NRecs) * recl)) {
+        EXTERR("Could not memory-map SHDFile: %s", FileName.c_str());
+    }
+    outputs.uAllSources = (cpxf *)tlFile.Data();
+    Pos->TLRecCpxf      = (int32_t)(recl / sizeof(cpxf));
+}
+
+template<bool O3D, bool R3D> void FreeTL(
+    bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs)
+{
+    MappedFile &tlFile = GetInternal(params)->tlFile;
+    if(tlFile.IsOpen() && (void *)outputs.uAllSources == tlFile.Data()) {
+        // LP: The data stays in the .shd file.
+        tlFile.Close();
+        outputs.uAllSources = nullptr;
+    } else {
+        trackdeallocate(params, outputs.uAllSources);
+    }
+}
+
+#if BHC_ENABLE_2D
+template void AllocateTL<false, false>(
+    bhcParams<false> &params, bhcOutputs<false, false> &outputs, bool mapFile);
+template void FreeTL<false, false>(
+    bhcParams<false> &params, bhcOutputs<false, false> &outputs);
+#endif
+#if BHC_ENABLE_NX2D
+template void AllocateTL<true, false>(
+    bhcParams<true> &params, bhcOutputs<true, false> &outputs, bool mapFile);
+template void FreeTL<true, false>(
+    bhcParams<true> &params, bhcOutputs<true, false> &outputs);
+#endif
+#if BHC_ENABLE_3D
+template void AllocateTL<true, true>(
+    bhcParams<true> &params, bhcOutputs<true, true> &outputs, bool mapFile);
+template void FreeTL<true, true>(
+    bhcParams<true> &params, bhcOutputs<true, true> &outputs);
+#endif
+
 /**
- * LP: Write TL results
+ * LP: Nominal sound speed and beam epsilons at one source, for ScalePressure.
+ */
+struct TLSourceScale {
+    real c;
+    cpx epsilon1, epsilon2;
+};
+
+/**
+ * LP: Scale TL results (convert to pressure)
+ *
+ * The nominal SSP at each source is computed serially, and then the field is
+ * scaled in parallel. Each worker gets a contiguous range of rows (Nr values
+ * for one frequency, source, bearing, and depth) in the GetFieldAddr layout.
+ * ScalePressure treats every row the same, so it is called once for each part
+ * of a source's block which is in the worker's range. If the field is the
+ * mapped .shd file, the rows are not contiguous, so it is called for each row.
  */
 template<bool O3D, bool R3D> void PostProcessTL(
     const bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs)
 {
     ErrState errState;
     ResetErrState(&errState);
+    const Position *Pos      = params.Pos;
+    const FreqInfo *freqinfo = params.freqinfo;
+    size_t NSrc              = (size_t)Pos->NSz * (size_t)Pos->NSx * (size_t)Pos->NSy;
+    std::vector<TLSourceScale> scale(NSrc);
+    // LP: Each source's segment search starts from the previous source's
+    // segment, which is usually nearby.
+    SSPSegState iSeg;
+    iSeg.r = iSeg.x = iSeg.y = iSeg.z = 0;
     for(int32_t isz = 0; isz < params.Pos->NSz; ++isz) {
         for(int32_t isx = 0; isx < params.Pos->NSx; ++isx) {
             for(int32_t isy = 0; isy < params.Pos->NSy; ++isy) {
-                SSPSegState iSeg;
-                iSeg.r = iSeg.x = iSeg.y = iSeg.z = 0;
                 VEC23<O3D> xs, tinit;
                 SSPOutputs<O3D> o;
                 char st = params.ssp->Type;
@@ -166,17 +267,59 @@ template<bool O3D, bool R3D> void PostProcessTL(
                     isz = params.Pos->NSz;
                     break;
                 }
-                ScalePressure<O3D, R3D>(
-                    params.Angles->alpha.d, params.Angles->beta.d, o.ccpx.real(),
-                    epsilon1, epsilon2, params.Pos->Rr,
-                    &outputs
-                         .uAllSources[GetFieldAddr(isx, isy, isz, 0, 0, 0, params.Pos)],
-                    params.Pos->Ntheta, params.Pos->NRz_per_range, params.Pos->NRr,
-                    params.freqinfo->freq0, params.Beam);
+                TLSourceScale &sc
+                    = scale[((size_t)isz * Pos->NSx + isx) * Pos->NSy + isy];
+                sc.c        = o.ccpx.real();
+                sc.epsilon1 = epsilon1;
+                sc.epsilon2 = epsilon2;
             }
         }
     }
     CheckReportErrors(GetInternal(params), &errState);
+
+    size_t srcRows     = (size_t)Pos->Ntheta * (size_t)Pos->NRz_per_range;
+    size_t NRows       = (size_t)freqinfo->NfreqTL * NSrc * srcRows;
+    ThreadPool &pool   = GetInternal(params)->threadPool;
+    int32_t numThreads = pool.NumThreads();
+    Progress &progress = GetInternal(params)->progress;
+    progress.SetUnits(NRows);
+    pool.Run([&](int32_t worker) {
+        size_t row    = NRows * worker / numThreads;
+        size_t rowEnd = NRows * (worker + 1) / numThreads;
+        while(row < rowEnd) {
+            size_t block            = row / srcRows; // frequency and source
+            size_t nRows            = bhc::min((block + 1) * srcRows, rowEnd) - row;
+            int32_t ifreq           = (int32_t)(block / NSrc);
+            const TLSourceScale &sc = scale[block % NSrc];
+            real freq = freqinfo->NfreqTL == 1 ? freqinfo->freq0
+                                               : freqinfo->freqVec[ifreq];
+            if(Pos->TLRecCpxf == 0) {
+                ScalePressure<O3D, R3D>(
+                    params.Angles->alpha.d, params.Angles->beta.d, sc.c, sc.epsilon1,
+                    sc.epsilon2, Pos->Rr, &outputs.uAllSources[row * (size_t)Pos->NRr],
+                    1, (int32_t)nRows, Pos->NRr, freq, params.Beam);
+            } else {
+                size_t isrc = block % NSrc;
+                int32_t isy = (int32_t)(isrc % Pos->NSy);
+                int32_t isx = (int32_t)(isrc / Pos->NSy % Pos->NSx);
+                int32_t isz = (int32_t)(isrc / ((size_t)Pos->NSy * Pos->NSx));
+                for(size_t r = row; r < row + nRows; ++r) {
+                    size_t k       = r % srcRows;
+                    int32_t itheta = (int32_t)(k / Pos->NRz_per_range);
+                    int32_t Irz1   = (int32_t)(k % Pos->NRz_per_range);
+                    size_t rec     = GetRecNum(
+                        isx, isy, ifreq, itheta, isz, Irz1, Pos, freqinfo->NfreqTL);
+                    ScalePressure<O3D, R3D>(
+                        params.Angles->alpha.d, params.Angles->beta.d, sc.c, sc.epsilon1,
+                        sc.epsilon2, Pos->Rr,
+                        &outputs.uAllSources[rec * (size_t)Pos->TLRecCpxf], 1, 1,
+                        Pos->NRr, freq, params.Beam);
+                }
+            }
+            progress.Add(nRows);
+            row += nRows;
+        }
+    });
 }
 
 #if BHC_ENABLE_2D
@@ -192,18 +335,10 @@ template void PostProcessTL<true, true>(
     const bhcParams<true> &params, bhcOutputs<true, true> &outputs);
 #endif
 
-template<bool O3D> inline size_t GetRecNum(
-    const bhcParams<O3D> &params, int32_t isx, int32_t isy, int32_t itheta, int32_t isz,
-    int32_t Irz1)
-{
-    // clang-format off
-    return        10                     + ((((size_t)isx
-        * (size_t)params.Pos->NSy           + (size_t)isy)
-        * (size_t)params.Pos->Ntheta        + (size_t)itheta)
-        * (size_t)params.Pos->NSz           + (size_t)isz)
-        * (size_t)params.Pos->NRz_per_range + (size_t)Irz1;
-    // clang-format on
-}
+/**
+ * LP: Size of the in-memory buffer used to assemble SHD file data records.
+ */
+constexpr size_t SHDWriteChunkBytes = 16ull * 1024ull * 1024ull;
 
 /**
  * LP: Write TL results
@@ -211,6 +346,25 @@ template<bool O3D> inline size_t GetRecNum(
 template<bool O3D, bool R3D> void WriteOutTL(
     const bhcParams<O3D> &params, const bhcOutputs<O3D, R3D> &outputs)
 {
+    Progress &progress = GetInternal(params)->progress;
+    if(params.Pos->TLRecCpxf != 0) {
+        // LP: The field was accumulated directly in the mapped .shd file, which
+        // already has its header, so it only has to be written back to disk.
+        // If writing out to a different FileRoot, the file is copied there.
+        MappedFile &tlFile   = GetInternal(params)->tlFile;
+        std::string FileName = GetInternal(params)->FileRoot + ".shd";
+        progress.SetUnits(1);
+        if(!tlFile.Flush()) EXTERR("Failed to write SHDFile");
+        if(FileName != tlFile.Path()) {
+            std::ofstream SHDFile(FileName, std::ios::binary | std::ios::trunc);
+            SHDFile.write((const char *)tlFile.Data(), (std::streamsize)tlFile.Size());
+            if(!SHDFile.good()) {
+                EXTERR("Could not write SHDFile: %s", FileName.c_str());
+            }
+        }
+        progress.Add(1);
+        return;
+    }
     real atten = FL(0.0);
     std::string PlotType;
     DirectOFile SHDFile(GetInternal(params));
@@ -222,29 +376,59 @@ template<bool O3D, bool R3D> void WriteOutTL(
 
     // clang-format off
     // LP: There are three different orders of the data used here.
-    // Field: (largest) Z, X, Y, theta, depth, radius (smallest)
-    // File:  (largest) X, Y, theta, Z, depth, radius (smallest)
+    // Field: (largest) freq, Z, X, Y, theta, depth, radius (smallest)
+    // File:  (largest) X, Y, freq, theta, Z, depth, radius (smallest)
     // Write: (largest) Z, X, Y, depth, theta, radius (smallest)
     // (XYZ are source; theta depth radius are receiver)
     // clang-format on
     // Since the write order doesn't change the file contents, the write order
-    // has been changed to match the file order, to hopefully speed up I/O.
-    for(int32_t isx = 0; isx < params.Pos->NSx; ++isx) {
-        for(int32_t isy = 0; isy < params.Pos->NSy; ++isy) {
-            for(int32_t itheta = 0; itheta < params.Pos->Ntheta; ++itheta) {
-                for(int32_t isz = 0; isz < params.Pos->NSz; ++isz) {
-                    for(int32_t Irz1 = 0; Irz1 < params.Pos->NRz_per_range; ++Irz1) {
-                        SHDFile.rec(GetRecNum(params, isx, isy, itheta, isz, Irz1));
-                        for(int32_t r = 0; r < params.Pos->NRr; ++r) {
-                            cpxf v = outputs.uAllSources[GetFieldAddr(
-                                isx, isy, isz, itheta, Irz1, r, params.Pos)];
-                            DOFWRITEV(SHDFile, v);
-                        }
-                    }
-                }
+    // has been changed to match the file order, so the data records are
+    // sequential. They are assembled in memory in chunks, in parallel, and each
+    // chunk is written with a single write.
+    const Position *Pos = params.Pos;
+    size_t fieldSize    = GetFieldSize(Pos);
+    size_t recl         = SHDFile.reclen();
+    size_t NRz          = Pos->NRz_per_range;
+    size_t NSz          = Pos->NSz;
+    size_t Ntheta       = Pos->Ntheta;
+    size_t Nfreq        = params.freqinfo->NfreqTL;
+    size_t NSy          = Pos->NSy;
+    size_t NRecs        = (size_t)Pos->NSx * NSy * Nfreq * Ntheta * NSz * NRz;
+    size_t dataBytes    = (size_t)Pos->NRr * sizeof(cpxf);
+    size_t chunkRecs = bhc::min(bhc::max(SHDWriteChunkBytes / recl, (size_t)1), NRecs);
+    if(chunkRecs == 0) return;
+    char *buf = nullptr;
+    trackallocate(params, "SHD file write buffer", buf, chunkRecs * recl);
+    ThreadPool &pool   = GetInternal(params)->threadPool;
+    int32_t numThreads = pool.NumThreads();
+    progress.SetUnits(NRecs);
+    for(size_t rec0 = 0; rec0 < NRecs; rec0 += chunkRecs) {
+        size_t nr = bhc::min(chunkRecs, NRecs - rec0);
+        pool.Run([&](int32_t worker) {
+            size_t b = nr * worker / numThreads;
+            size_t e = nr * (worker + 1) / numThreads;
+            for(size_t i = b; i < e; ++i) {
+                size_t k       = rec0 + i;
+                int32_t Irz1   = (int32_t)(k % NRz);
+                int32_t isz    = (int32_t)(k / NRz % NSz);
+                int32_t itheta = (int32_t)(k / (NRz * NSz) % Ntheta);
+                int32_t ifreq  = (int32_t)(k / (NRz * NSz * Ntheta) % Nfreq);
+                int32_t isy    = (int32_t)(k / (NRz * NSz * Ntheta * Nfreq) % NSy);
+                int32_t isx    = (int32_t)(k / (NRz * NSz * Ntheta * Nfreq * NSy));
+                char *dst      = &buf[i * recl];
+                memcpy(
+                    dst,
+                    &outputs.uAllSources
+                         [(size_t)ifreq * fieldSize
+                          + GetFieldAddr(isx, isy, isz, itheta, Irz1, 0, Pos)],
+                    dataBytes);
+                memset(dst + dataBytes, 0, recl - dataBytes);
             }
-        }
+        });
+        SHDFile.writerecs(10 + rec0, buf, nr);
+        progress.Add(nr);
     }
+    trackdeallocate(params, buf);
 }
 
 #if BHC_ENABLE_2D
@@ -296,7 +480,6 @@ template<bool O3D, bool R3D> void ReadOutTL(
     float atten;
     DIFREADV(SHDFile, atten);
 
-    if(freqinfo->Nfreq != 1) { EXTERR("Nfreq in SHDFile being loaded is not 1"); }
     if constexpr(!O3D) {
         if(Pos->Ntheta != 1 || Pos->NSx != 1 || Pos->NSy != 1) {
             EXTERR(
@@ -340,20 +523,27 @@ template<bool O3D, bool R3D> void ReadOutTL(
     module::SzRz<O3D> szrz;
     szrz.Preprocess(params); // sets NRz_per_range
     TL<O3D, R3D> tl;
-    tl.Preprocess(params, outputs);
+    tl.Preprocess(params, outputs, false);
 
+    size_t fieldSize = GetFieldSize(Pos);
     for(int32_t isx = 0; isx < Pos->NSx; ++isx) {
         for(int32_t isy = 0; isy < Pos->NSy; ++isy) {
-            for(int32_t itheta = 0; itheta < Pos->Ntheta; ++itheta) {
-                for(int32_t isz = 0; isz < Pos->NSz; ++isz) {
-                    for(int32_t Irz1 = 0; Irz1 < Pos->NRz_per_range; ++Irz1) {
-                        DIFREC(SHDFile, GetRecNum(params, isx, isy, itheta, isz, Irz1));
-                        for(int32_t r = 0; r < Pos->NRr; ++r) {
-                            cpxf v;
-                            DIFREADV(SHDFile, v);
-                            outputs.uAllSources
-                                [GetFieldAddr(isx, isy, isz, itheta, Irz1, r, params.Pos)]
-                                = v;
+            for(int32_t ifreq = 0; ifreq < freqinfo->NfreqTL; ++ifreq) {
+                cpxf *u = &outputs.uAllSources[(size_t)ifreq * fieldSize];
+                for(int32_t itheta = 0; itheta < Pos->Ntheta; ++itheta) {
+                    for(int32_t isz = 0; isz < Pos->NSz; ++isz) {
+                        for(int32_t Irz1 = 0; Irz1 < Pos->NRz_per_range; ++Irz1) {
+                            DIFREC(
+                                SHDFile,
+                                GetRecNum(
+                                    isx, isy, ifreq, itheta, isz, Irz1, Pos,
+                                    freqinfo->NfreqTL));
+                            for(int32_t r = 0; r < Pos->NRr; ++r) {
+                                cpxf v;
+                                DIFREADV(SHDFile, v);
+                                u[GetFieldAddr(isx, isy, isz, itheta, Irz1, r, params.Pos)]
+                                    = v;
+                            }
                         }
                     }
                 }
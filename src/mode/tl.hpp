@@ -22,6 +22,24 @@ this program. If not, see <https://www.gnu.org/licenses/>.
 
 namespace bhc { namespace mode {
 
+template<bool O3D, bool R3D> void AllocateTL(
+    bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs, bool mapFile);
+extern template void AllocateTL<false, false>(
+    bhcParams<false> &params, bhcOutputs<false, false> &outputs, bool mapFile);
+extern template void AllocateTL<true, false>(
+    bhcParams<true> &params, bhcOutputs<true, false> &outputs, bool mapFile);
+extern template void AllocateTL<true, true>(
+    bhcParams<true> &params, bhcOutputs<true, true> &outputs, bool mapFile);
+
+template<bool O3D, bool R3D> void FreeTL(
+    bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs);
+extern template void FreeTL<false, false>(
+    bhcParams<false> &params, bhcOutputs<false, false> &outputs);
+extern template void FreeTL<true, false>(
+    bhcParams<true> &params, bhcOutputs<true, false> &outputs);
+extern template void FreeTL<true, true>(
+    bhcParams<true> &params, bhcOutputs<true, true> &outputs);
+
 template<bool O3D, bool R3D> void PostProcessTL(
     const bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs);
 extern template void PostProcessTL<false, false>(
@@ -62,15 +80,23 @@ public:
     virtual void Preprocess(
         bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs) const override
     {
-        Field<O3D, R3D>::Preprocess(params, outputs);
+        Preprocess(params, outputs, GetInternal(params)->mappedTLFile);
+        // LP: Leave half of the rest for FieldTiles.
+        size_t used = GetInternal(params)->usedMemory;
+        this->PreprocessRayFan(
+            params, outputs, used + (GetInternal(params)->maxMemory - used) / 2);
+    }
 
-        trackdeallocate(params, outputs.uAllSources); // Free if previously run
+    /**
+     * mapFile: whether the field may be the memory-mapped .shd file (see
+     * bhcInit::mappedTLFile); false when reading a .shd file.
+     */
+    void Preprocess(
+        bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs, bool mapFile) const
+    {
+        Field<O3D, R3D>::Preprocess(params, outputs);
         // for a TL calculation, allocate space for the pressure matrix
-        const Position *Pos = params.Pos;
-        size_t n            = (size_t)Pos->NSz * (size_t)Pos->NSx * (size_t)Pos->NSy
-            * (size_t)Pos->Ntheta * (size_t)Pos->NRz_per_range * (size_t)Pos->NRr;
-        trackallocate(params, "sound field / transmission loss", outputs.uAllSources, n);
-        memset(outputs.uAllSources, 0, n * sizeof(cpxf));
+        AllocateTL<O3D, R3D>(params, outputs, mapFile);
     }
 
     virtual void Postprocess(
@@ -95,7 +121,7 @@ public:
     virtual void Finalize(
         bhcParams<O3D> &params, bhcOutputs<O3D, R3D> &outputs) const override
     {
-        trackdeallocate(params, outputs.uAllSources);
+        FreeTL<O3D, R3D>(params, outputs);
     }
 };
 
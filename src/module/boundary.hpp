@@ -468,6 +468,28 @@ public:
         }
     }
 
+    virtual bool Hash(bhcParams<O3D> &params, ParamsHash &h) const override
+    {
+        BdryInfoTopBot<O3D> *bdinfotb = GetBdryInfoTopBot(params);
+        int32_t n;
+        if constexpr(O3D) {
+            h.Add(bdinfotb->NPts.x);
+            h.Add(bdinfotb->NPts.y);
+            n = bdinfotb->NPts.x * bdinfotb->NPts.y;
+        } else {
+            n = bdinfotb->NPts;
+        }
+        h.Add(bdinfotb->type[0]);
+        h.Add(bdinfotb->type[1]);
+        h.Add(bdinfotb->dirty);
+        h.Add(bdinfotb->rangeInKm);
+        h.Add(BdryDepth(params));
+        h.Add(n);
+        // LP: Everything else is only read by Preprocess if dirty is set.
+        for(int32_t i = 0; i < n; ++i) h.Add(bdinfotb->bd[i].x);
+        return true;
+    }
+
     virtual void Finalize(bhcParams<O3D> &params) const override
     {
         BdryInfoTopBot<O3D> *bdinfotb = GetBdryInfoTopBot(params);
@@ -29,8 +29,9 @@ namespace bhc { namespace module {
  * LP: This is not properly supported in BELLHOP(3D). The broadband option can
  * never be selected because that letter is used to select dev mode (single beam),
  * and putting 'B' there is considered invalid. Plus, freqVec is never read during
- * the beam trace or influence. However, this can't be removed, as the frequency
- * vector must be written out to the shade file.
+ * the beam trace or influence. In BELLHOP(3D), this only exists to be written
+ * out to the shade file; here, if bhcInit::broadbandTL is set, TL runs compute
+ * the field for each frequency (see ApplyContribution).
  */
 template<bool O3D> class FreqVec : public ParamsModule<O3D> {
 public:
@@ -40,6 +41,7 @@ public:
     virtual void Init(bhcParams<O3D> &params) const override
     {
         params.freqinfo->freqVec = nullptr;
+        params.freqinfo->NfreqTL = 1;
     }
     virtual void SetupPre(bhcParams<O3D> &params) const override
     {
@@ -55,6 +55,11 @@ public:
     /// Modifies the parameters before processing, e.g. km to m. Module must add
     /// flags to params to track whether this has been done or not.
     virtual void Preprocess(bhcParams<O3D> &) const {}
+    /// Hash everything Validate and Preprocess read (including flags and any
+    /// values from other modules), so run() can skip both if nothing changed
+    /// since the previous run. Returns false if not supported, in which case
+    /// the module is always validated and preprocessed.
+    virtual bool Hash(bhcParams<O3D> &, ParamsHash &) const { return false; }
     /// Deallocate memory.
     virtual void Finalize(bhcParams<O3D> &) const {}
 };
@@ -166,6 +166,19 @@ public:
         }
     }
 
+    virtual bool Hash(bhcParams<O3D> &params, ParamsHash &h) const override
+    {
+        h.Add(params.Bdry->Bot.hs.Opt[0]);
+        h.Add(GetModeFlag(params));
+        if(!IsFile(params)) return true;
+        ReflectionInfoTopBot *refltb = GetReflTopBot(params);
+        h.Add(refltb->inDegrees);
+        if(refltb->r == nullptr) return true;
+        h.AddArray(
+            &refltb->r[0].theta, refltb->NPts * sizeof(ReflectionCoef) / sizeof(real));
+        return true;
+    }
+
     virtual void Finalize(bhcParams<O3D> &params) const override
     {
         ReflectionInfoTopBot *refltb = GetReflTopBot(params);
@@ -152,6 +152,14 @@ public:
         }
     }
 
+    virtual bool Hash(bhcParams<O3D> &params, ParamsHash &h) const override
+    {
+        SBPInfo *sbp = params.sbp;
+        h.Add(sbp->SBPIndB);
+        h.AddArray(sbp->SrcBmPat, sbp->NSBPPts * 2);
+        return true;
+    }
+
     virtual void Finalize(bhcParams<O3D> &params) const override
     {
         trackdeallocate(params, params.sbp->SrcBmPat);
@@ -38,12 +38,41 @@ public:
         ssp->Seg.x = nullptr;
         ssp->Seg.y = nullptr;
         ssp->Seg.z = nullptr;
+
+        ssp->z      = nullptr;
+        ssp->rho    = nullptr;
+        ssp->alphaR = nullptr;
+        ssp->alphaI = nullptr;
+        ssp->betaR  = nullptr;
+        ssp->betaI  = nullptr;
+        ssp->c      = nullptr;
+        ssp->cz     = nullptr;
+        ssp->n2     = nullptr;
+        ssp->n2z    = nullptr;
+        for(int32_t i = 0; i < 4; ++i) {
+            ssp->cSpline[i] = nullptr;
+            ssp->cCoef[i]   = nullptr;
+            ssp->CSWork[i]  = nullptr;
+        }
+        ssp->hexCoef       = nullptr;
+        ssp->SegInvWidth.r = nullptr;
+        ssp->SegInvWidth.x = nullptr;
+        ssp->SegInvWidth.y = nullptr;
+        ssp->SegInvWidth.z = nullptr;
+        ssp->NPts      = 0;
+        ssp->NPtsAlloc = 0;
+        ssp->zInvDelta     = RL(0.0);
+        ssp->SegInvDelta.r = RL(0.0);
+        ssp->SegInvDelta.x = RL(0.0);
+        ssp->SegInvDelta.y = RL(0.0);
+        ssp->SegInvDelta.z = RL(0.0);
     }
 
     virtual void SetupPre(bhcParams<O3D> &params) const override
     {
         SSPStructure *ssp = params.ssp;
 
+        AllocatePoints(params, 2);
         ssp->NPts = 2;
         ssp->z[0] = RL(0.0);
         ssp->z[1] = RL(5000.0);
@@ -90,6 +119,11 @@ public:
                 EXTERR("ReadSSP: Number of SSP points exceeds limit");
                 return;
             }
+            if(ssp->NPts >= ssp->NPtsAlloc) {
+                // LP: The number of points is not known until the last one is
+                // read, so grow the arrays as needed.
+                AllocatePoints(params, bhc::min(2 * ssp->NPtsAlloc, MaxSSP));
+            }
 
             LIST_WARNLINE(ENVFile);
             ENVFile.Read(ssp->z[ssp->NPts]);
@@ -273,6 +307,15 @@ public:
         // [mbp:] bottom depth should perhaps be set the same way?
     }
 
+    void ExtSetup(bhcParams<O3D> &params, int32_t NPts) const
+    {
+        SSPStructure *ssp = params.ssp;
+        AllocatePoints(params, NPts);
+        ssp->NPts  = NPts;
+        ssp->Nz    = NPts;
+        ssp->dirty = true;
+    }
+
     void ExtSetup(
         bhcParams<O3D> &params, int32_t NPts_Nx, int32_t Nr_Ny,
         [[maybe_unused]] int32_t None_Nz) const
@@ -281,6 +324,7 @@ public:
         if constexpr(!O3D) {
             // quad
             ssp->Type = 'Q';
+            AllocatePoints(params, NPts_Nx);
             ssp->NPts = NPts_Nx;
             ssp->Nr   = Nr_Ny;
         } else {
@@ -358,6 +402,12 @@ public:
 
         if(ssp->NPts > MaxSSP) {
             EXTERR("ReadSSP: Number of SSP points exceeds limit");
+        } else if(ssp->Type != 'H' && ssp->NPts > ssp->NPtsAlloc) {
+            // LP: Hexahedral mode allocates the depths itself in SegZToZ.
+            EXTERR(
+                "ssp->NPts (%d) exceeds the number of SSP points allocated (%d); "
+                "use extsetup_ssp() to set the number of points",
+                ssp->NPts, ssp->NPtsAlloc);
         } else if(ssp->NPts < 2) {
             EXTERR("ReadSSP: The SSP must have at least 2 points");
         }
@@ -462,6 +512,16 @@ public:
             ssp->rangeInKm = false;
         }
 
+        // LP: In hexahedral mode, z is only used for attenuation, with the
+        // segment found in Seg.z.
+        bool hex           = ssp->Type == 'H';
+        ssp->zInvDelta     = hex ? RL(0.0) : UniformInvDelta(ssp->z, ssp->NPts);
+        ssp->SegInvDelta.r = ssp->Type == 'Q' ? UniformInvDelta(ssp->Seg.r, ssp->Nr)
+                                              : RL(0.0);
+        ssp->SegInvDelta.x = hex ? UniformInvDelta(ssp->Seg.x, ssp->Nx) : RL(0.0);
+        ssp->SegInvDelta.y = hex ? UniformInvDelta(ssp->Seg.y, ssp->Ny) : RL(0.0);
+        ssp->SegInvDelta.z = hex ? UniformInvDelta(ssp->Seg.z, ssp->Nz) : RL(0.0);
+
         if(!ssp->dirty) return;
         ssp->dirty = false;
 
@@ -478,6 +538,7 @@ public:
                     }
                 }
             }
+            PrecomputeHex(params);
             SegZToZ(params);
             // LP: ssp->c and ssp->cz are not well-defined in hexahedral mode, and
             // if the number of depths is changed (ssp->Nz vs. ssp->NPts), computing
@@ -497,6 +558,9 @@ public:
         // LP: Gradient at last point is uninitialized.
         ssp->cz[ssp->NPts - 1] = cpx(NAN, NAN);
 
+        AllocateDerived(params);
+        PrecomputeHex(params);
+
         switch(ssp->Type) {
         case 'N': // N2-linear profile option
             for(int32_t i = 0; i < ssp->NPts; ++i) ssp->n2[i] = FL(1.0) / SQ(ssp->c[i]);
@@ -541,6 +605,27 @@ public:
         }
     }
 
+    virtual bool Hash(bhcParams<O3D> &params, ParamsHash &h) const override
+    {
+        SSPStructure *ssp = params.ssp;
+        h.Add(ssp->Type);
+        h.Add(ssp->dirty);
+        h.Add(ssp->rangeInKm);
+        h.Add(ssp->Nr);
+        h.Add(ssp->Nx);
+        h.Add(ssp->Ny);
+        h.Add(ssp->Nz);
+        h.AddArray(ssp->z, ssp->NPts);
+        h.AddArray(ssp->Seg.r, ssp->Seg.r == nullptr ? 0 : ssp->Nr);
+        h.AddArray(ssp->Seg.x, ssp->Seg.x == nullptr ? 0 : ssp->Nx);
+        h.AddArray(ssp->Seg.y, ssp->Seg.y == nullptr ? 0 : ssp->Ny);
+        h.AddArray(ssp->Seg.z, ssp->Seg.z == nullptr ? 0 : ssp->Nz);
+        h.Add(params.Bdry->Top.hs.Depth);
+        h.Add(params.Bdry->Bot.hs.Depth);
+        // LP: Everything else is only read by Preprocess if dirty is set.
+        return true;
+    }
+
     virtual void Finalize(bhcParams<O3D> &params) const override
     {
         SSPStructure *ssp = params.ssp;
@@ -551,15 +636,174 @@ public:
         trackdeallocate(params, ssp->Seg.x);
         trackdeallocate(params, ssp->Seg.y);
         trackdeallocate(params, ssp->Seg.z);
+
+        trackdeallocate(params, ssp->z);
+        trackdeallocate(params, ssp->rho);
+        trackdeallocate(params, ssp->alphaR);
+        trackdeallocate(params, ssp->alphaI);
+        trackdeallocate(params, ssp->betaR);
+        trackdeallocate(params, ssp->betaI);
+        trackdeallocate(params, ssp->c);
+        trackdeallocate(params, ssp->cz);
+        ssp->NPtsAlloc = 0;
+        AllocateDerived(params);
+        PrecomputeHex(params);
     }
 
 private:
+    constexpr static const char *Description = "SSP";
+
+    /**
+     * LP: Copies the first nkeep elements into a new allocation of n elements.
+     */
+    template<typename T> void Reallocate(
+        bhcParams<O3D> &params, T *&ptr, int32_t nkeep, int32_t n) const
+    {
+        T *old = ptr;
+        ptr    = nullptr;
+        trackallocate(params, Description, ptr, n);
+        if(old != nullptr) {
+            memcpy(ptr, old, nkeep * sizeof(T));
+            trackdeallocate(params, old);
+        }
+    }
+    /**
+     * LP: Reallocates the per-depth input data (and c and cz, which are also
+     * written per depth in hexahedral mode) to n points, keeping the existing
+     * values which fit.
+     */
+    void AllocatePoints(bhcParams<O3D> &params, int32_t n) const
+    {
+        SSPStructure *ssp = params.ssp;
+        int32_t nkeep     = bhc::min(ssp->NPtsAlloc, n);
+        Reallocate(params, ssp->z, nkeep, n);
+        Reallocate(params, ssp->rho, nkeep, n);
+        Reallocate(params, ssp->alphaR, nkeep, n);
+        Reallocate(params, ssp->alphaI, nkeep, n);
+        Reallocate(params, ssp->betaR, nkeep, n);
+        Reallocate(params, ssp->betaI, nkeep, n);
+        Reallocate(params, ssp->c, nkeep, n);
+        Reallocate(params, ssp->cz, nkeep, n);
+        ssp->NPtsAlloc = n;
+    }
+    /**
+     * LP: Allocates the derived per-depth data needed by the current SSP
+     * type, and frees the rest.
+     */
+    void AllocateDerived(bhcParams<O3D> &params) const
+    {
+        SSPStructure *ssp = params.ssp;
+        trackdeallocate(params, ssp->n2);
+        trackdeallocate(params, ssp->n2z);
+        for(int32_t i = 0; i < 4; ++i) {
+            trackdeallocate(params, ssp->cSpline[i]);
+            trackdeallocate(params, ssp->cCoef[i]);
+            trackdeallocate(params, ssp->CSWork[i]);
+        }
+        if(ssp->NPtsAlloc == 0) return;
+        if(ssp->Type == 'N') {
+            trackallocate(params, "N2-linear SSP", ssp->n2, ssp->NPts);
+            trackallocate(params, "N2-linear SSP", ssp->n2z, ssp->NPts);
+        } else if(ssp->Type == 'S') {
+            for(int32_t i = 0; i < 4; ++i) {
+                trackallocate(params, "cubic spline SSP", ssp->cSpline[i], ssp->NPts);
+            }
+        } else if(ssp->Type == 'P') {
+            for(int32_t i = 0; i < 4; ++i) {
+                trackallocate(params, "PCHIP SSP", ssp->cCoef[i], ssp->NPts);
+                trackallocate(params, "PCHIP SSP", ssp->CSWork[i], ssp->NPts);
+            }
+        }
+    }
+
+    /**
+     * LP: If bhcInit::precomputeHexSSP and the SSP is hexahedral, computes the
+     * interpolation coefficients of every cell from cMat and czMat (see
+     * HexSSPCoef); otherwise frees them. Must be called after czMat is
+     * computed.
+     */
+    void PrecomputeHex(bhcParams<O3D> &params) const
+    {
+        SSPStructure *ssp = params.ssp;
+        trackdeallocate(params, ssp->hexCoef);
+        trackdeallocate(params, ssp->SegInvWidth.x);
+        trackdeallocate(params, ssp->SegInvWidth.y);
+        trackdeallocate(params, ssp->SegInvWidth.z);
+        if(ssp->NPtsAlloc == 0 || ssp->Type != 'H' || ssp->cMat == nullptr) return;
+        if(!GetInternal(params)->precomputeHexSSP) return;
+
+        int32_t Nx = ssp->Nx, Ny = ssp->Ny, Nz = ssp->Nz;
+        trackallocate(
+            params, "hexahedral SSP coefficients", ssp->hexCoef,
+            (size_t)(Nx - 1) * (size_t)(Ny - 1) * (size_t)(Nz - 1));
+        trackallocate(params, "hexahedral SSP coefficients", ssp->SegInvWidth.x, Nx - 1);
+        trackallocate(params, "hexahedral SSP coefficients", ssp->SegInvWidth.y, Ny - 1);
+        trackallocate(params, "hexahedral SSP coefficients", ssp->SegInvWidth.z, Nz - 1);
+        for(int32_t i = 0; i < Nx - 1; ++i) {
+            ssp->SegInvWidth.x[i] = RL(1.0) / (ssp->Seg.x[i + 1] - ssp->Seg.x[i]);
+        }
+        for(int32_t i = 0; i < Ny - 1; ++i) {
+            ssp->SegInvWidth.y[i] = RL(1.0) / (ssp->Seg.y[i + 1] - ssp->Seg.y[i]);
+        }
+        for(int32_t i = 0; i < Nz - 1; ++i) {
+            ssp->SegInvWidth.z[i] = RL(1.0) / (ssp->Seg.z[i + 1] - ssp->Seg.z[i]);
+        }
+
+        const real *cM  = ssp->cMat;
+        const real *czM = ssp->czMat;
+        for(int32_t ix = 0; ix < Nx - 1; ++ix) {
+            for(int32_t iy = 0; iy < Ny - 1; ++iy) {
+                for(int32_t iz = 0; iz < Nz - 1; ++iz) {
+                    // LP: Corners (x, y): 11 = (0, 0), 21 = (1, 0), 12 = (0, 1)
+                    size_t c11 = ((size_t)ix * Ny + iy) * Nz + iz;
+                    size_t c21 = ((size_t)(ix + 1) * Ny + iy) * Nz + iz;
+                    size_t c12 = ((size_t)ix * Ny + iy + 1) * Nz + iz;
+                    size_t c22 = ((size_t)(ix + 1) * Ny + iy + 1) * Nz + iz;
+                    size_t z11 = ((size_t)ix * Ny + iy) * (Nz - 1) + iz;
+                    size_t z21 = ((size_t)(ix + 1) * Ny + iy) * (Nz - 1) + iz;
+                    size_t z12 = ((size_t)ix * Ny + iy + 1) * (Nz - 1) + iz;
+                    size_t z22 = ((size_t)(ix + 1) * Ny + iy + 1) * (Nz - 1) + iz;
+                    HexSSPCoef &k
+                        = ssp->hexCoef[((size_t)ix * (Ny - 1) + iy) * (Nz - 1) + iz];
+                    k.p[0] = cM[c11];
+                    k.p[1] = cM[c21] - cM[c11];
+                    k.p[2] = cM[c12] - cM[c11];
+                    k.p[3] = cM[c22] - cM[c21] - cM[c12] + cM[c11];
+                    k.q[0] = czM[z11];
+                    k.q[1] = czM[z21] - czM[z11];
+                    k.q[2] = czM[z12] - czM[z11];
+                    k.q[3] = czM[z22] - czM[z21] - czM[z12] + czM[z11];
+                }
+            }
+        }
+    }
+
+    /**
+     * LP: Returns 1 / spacing if every point of arr is within half a segment of
+     * where it would be if the points were uniformly spaced, otherwise 0. In
+     * that case the segment computed from the spacing is at most one away from
+     * the true segment, which UpdateSSPSegment then corrects.
+     */
+    real UniformInvDelta(const real *arr, int32_t n) const
+    {
+        if(arr == nullptr || n < 3) return RL(0.0);
+        real delta = (arr[n - 1] - arr[0]) / (real)(n - 1);
+        if(!(delta > RL(0.0))) return RL(0.0);
+        for(int32_t i = 1; i < n - 1; ++i) {
+            if(!(STD::abs(arr[i] - (arr[0] + (real)i * delta)) < RL(0.5) * delta)) {
+                return RL(0.0);
+            }
+        }
+        return RL(1.0) / delta;
+    }
+
     inline void SegZToZ(bhcParams<O3D> &params) const
     {
         SSPStructure *ssp = params.ssp;
         if(ssp->Nz > MaxSSP) {
             EXTERR("SSP: Hexahedral: Number of z coordinates exceeds limit");
         }
+        if(ssp->Nz > ssp->NPtsAlloc) AllocatePoints(params, ssp->Nz);
         // over-ride the SSP%z values read in from the environmental file with these
         // new values
         for(int32_t iz = 0; iz < ssp->Nz; ++iz) {
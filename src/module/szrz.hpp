@@ -33,7 +33,8 @@ public:
     virtual void Init(bhcParams<O3D> &params) const override
     {
         params.Pos->Sz = nullptr;
-        params.Pos->Rz = nullptr;
+        params.Pos->Rz        = nullptr;
+        params.Pos->TLRecCpxf = 0;
     }
     virtual void SetupPre(bhcParams<O3D> &params) const override
     {
@@ -33,21 +33,67 @@ namespace bhc {
         [[maybe_unused]] const SSPStructure *ssp, SSPSegState &iSeg, \
         [[maybe_unused]] ErrState *errState
 
+/**
+ * LP: Number of segments UpdateSSPSegment walks linearly before switching to
+ * binary search.
+ */
+constexpr int32_t SSPSegMaxWalk = 4;
+
+/**
+ * LP: Finds the segment of array (length n, monotonically increasing)
+ * containing x, starting from the previous segment iSeg. invDelta is 1 /
+ * spacing if the array is uniformly spaced, or 0 (see SSPStructure). The result
+ * only depends on x, t, and the array, not on the starting iSeg, so the search
+ * strategy does not affect results:
+ * - For uniformly spaced axes, jump directly to the segment (O(1)).
+ * - Otherwise, usually the ray has moved by 0 or 1 segments, so walk a few
+ *   steps from the previous segment, and fall back to binary search for long
+ *   jumps (e.g. at ray init or for steps crossing many cells) (O(log n)).
+ */
 HOST_DEVICE inline void UpdateSSPSegment(
-    real x, real t, const real *array, int32_t n, int32_t &iSeg)
+    real x, real t, const real *array, int32_t n, real invDelta, int32_t &iSeg)
 {
+    if(invDelta > RL(0.0)) {
+        real f = (x - array[0]) * invDelta;
+        iSeg   = f >= RL(0.0) ? (f < (real)(n - 2) ? (int32_t)f : n - 2) : 0;
+    }
     // LP: Handles edge cases based on which direction the ray is going. If the
     // ray takes a small step in the direction of t, it will remain in the same
     // segment as it is now.
-    if(t >= RL(0.0)) {
-        // array[iSeg] <= x < array[iSeg+1]
-        while(iSeg > 0 && x < array[iSeg]) --iSeg;
-        while(iSeg < n - 2 && x >= array[iSeg + 1]) ++iSeg;
-    } else {
-        // array[iSeg] < x <= array[iSeg+1]
-        while(iSeg < n - 2 && x > array[iSeg + 1]) ++iSeg;
-        while(iSeg > 0 && x <= array[iSeg]) --iSeg;
+    bool forward = t >= RL(0.0);
+    for(int32_t step = 0; step < SSPSegMaxWalk; ++step) {
+        if(forward) {
+            // array[iSeg] <= x < array[iSeg+1]
+            if(iSeg > 0 && x < array[iSeg]) {
+                --iSeg;
+            } else if(iSeg < n - 2 && x >= array[iSeg + 1]) {
+                ++iSeg;
+            } else {
+                return;
+            }
+        } else {
+            // array[iSeg] < x <= array[iSeg+1]
+            if(iSeg < n - 2 && x > array[iSeg + 1]) {
+                ++iSeg;
+            } else if(iSeg > 0 && x <= array[iSeg]) {
+                --iSeg;
+            } else {
+                return;
+            }
+        }
+    }
+    // Largest segment in [0, n-2] whose start is before x
+    int32_t low = 0;     // Low is included
+    int32_t hi  = n - 2; // Hi is included
+    while(low < hi) {
+        int32_t m = (low + hi + 1) / 2; // Round up
+        if(forward ? array[m] <= x : array[m] < x) {
+            low = m;
+        } else {
+            hi = m - 1;
+        }
     }
+    iSeg = low;
 }
 
 HOST_DEVICE inline real LinInterpDensity(
@@ -63,7 +109,7 @@ HOST_DEVICE inline real LinInterpDensity(
  */
 HOST_DEVICE inline void n2Linear(SSP_2D_FN_ARGS)
 {
-    UpdateSSPSegment(x.y, t.y, ssp->z, ssp->NPts, iSeg.z);
+    UpdateSSPSegment(x.y, t.y, ssp->z, ssp->NPts, ssp->zInvDelta, iSeg.z);
     real w = LinInterpDensity(x.y, ssp, iSeg, o.rho);
 
     o.ccpx = RL(1.0)
@@ -80,7 +126,7 @@ HOST_DEVICE inline void n2Linear(SSP_2D_FN_ARGS)
  */
 HOST_DEVICE inline void cLinear(SSP_2D_FN_ARGS)
 {
-    UpdateSSPSegment(x.y, t.y, ssp->z, ssp->NPts, iSeg.z);
+    UpdateSSPSegment(x.y, t.y, ssp->z, ssp->NPts, ssp->zInvDelta, iSeg.z);
     LinInterpDensity(x.y, ssp, iSeg, o.rho);
 
     o.ccpx  = ssp->c[iSeg.z] + (x.y - ssp->z[iSeg.z]) * ssp->cz[iSeg.z];
@@ -94,7 +140,7 @@ HOST_DEVICE inline void cLinear(SSP_2D_FN_ARGS)
  */
 HOST_DEVICE inline void cPCHIP(SSP_2D_FN_ARGS)
 {
-    UpdateSSPSegment(x.y, t.y, ssp->z, ssp->NPts, iSeg.z);
+    UpdateSSPSegment(x.y, t.y, ssp->z, ssp->NPts, ssp->zInvDelta, iSeg.z);
     LinInterpDensity(x.y, ssp, iSeg, o.rho);
 
     real xt = x.y - ssp->z[iSeg.z];
@@ -132,7 +178,7 @@ HOST_DEVICE inline void cPCHIP(SSP_2D_FN_ARGS)
  */
 HOST_DEVICE inline void cCubic(SSP_2D_FN_ARGS)
 {
-    UpdateSSPSegment(x.y, t.y, ssp->z, ssp->NPts, iSeg.z);
+    UpdateSSPSegment(x.y, t.y, ssp->z, ssp->NPts, ssp->zInvDelta, iSeg.z);
     LinInterpDensity(x.y, ssp, iSeg, o.rho);
 
     real hSpline = x.y - ssp->z[iSeg.z];
@@ -164,8 +210,8 @@ HOST_DEVICE inline void Quad(SSP_2D_FN_ARGS)
         //     "sspMod: Quad: ray is outside the box where the soundspeed is defined\n");
     }
 
-    UpdateSSPSegment(x.y, t.y, ssp->z, ssp->NPts, iSeg.z);
-    UpdateSSPSegment(x.x, t.x, ssp->Seg.r, ssp->Nr, iSeg.r);
+    UpdateSSPSegment(x.y, t.y, ssp->z, ssp->NPts, ssp->zInvDelta, iSeg.z);
+    UpdateSSPSegment(x.x, t.x, ssp->Seg.r, ssp->Nr, ssp->SegInvDelta.r, iSeg.r);
     LinInterpDensity(x.y, ssp, iSeg, o.rho);
     if(iSeg.z >= ssp->Nz - 1 || iSeg.r >= ssp->Nr - 1) {
         RunError(errState, BHC_ERR_QUAD_ISEG);
@@ -213,6 +259,52 @@ HOST_DEVICE inline void Quad(SSP_2D_FN_ARGS)
     o.czz   = RL(0.0);
 }
 
+/**
+ * Trilinear hexahedral interpolation of SSP data in 3D, using the per-cell
+ * coefficients precomputed by the SSP module (bhcInit::precomputeHexSSP).
+ * Same as the rest of Hexahedral, with fewer loads and no divisions.
+ */
+HOST_DEVICE inline void HexahedralCoef(
+    const vec3 &x, SSPOutputs<true> &o, const SSPStructure *ssp, const SSPSegState &iSeg)
+{
+    const HexSSPCoef &k = ssp->hexCoef
+        [((size_t)iSeg.x * (ssp->Ny - 1) + iSeg.y) * (ssp->Nz - 1) + iSeg.z];
+    real rdx = ssp->SegInvWidth.x[iSeg.x];
+    real rdy = ssp->SegInvWidth.y[iSeg.y];
+
+    // proportional distances in x and y, with piecewise constant extrapolation
+    // for points outside the box; s3 is the (absolute) depth within the cell
+    real s1 = bhc::max(bhc::min((x.x - ssp->Seg.x[iSeg.x]) * rdx, RL(1.0)), RL(0.0));
+    real s2 = bhc::max(bhc::min((x.y - ssp->Seg.y[iSeg.y]) * rdy, RL(1.0)), RL(0.0));
+    real s3 = x.z - ssp->Seg.z[iSeg.z];
+
+    real a0 = k.p[0] + s3 * k.q[0];
+    real a1 = k.p[1] + s3 * k.q[1];
+    real a2 = k.p[2] + s3 * k.q[2];
+    real a3 = k.p[3] + s3 * k.q[3];
+    real cs = a1 + s2 * a3; // dc/ds1
+
+    real c = a0 + s2 * a2 + s1 * cs;
+    // interpolate the attenuation; see Hexahedral
+    s3 *= ssp->SegInvWidth.z[iSeg.z];
+    real cimag = ((RL(1.0) - s3) * ssp->c[iSeg.z] + s3 * ssp->c[iSeg.z + 1]).imag();
+    o.ccpx     = cpx(c, cimag);
+
+    o.gradc.x = cs * rdx;
+    o.gradc.y = (a2 + s1 * a3) * rdy;
+    o.gradc.z = k.q[0] + s2 * k.q[2] + s1 * (k.q[1] + s2 * k.q[3]);
+
+    o.cxx = RL(0.0);
+    o.cyy = RL(0.0);
+    o.czz = RL(0.0);
+    o.cxy = RL(0.0);
+    o.cxz = RL(0.0);
+    o.cyz = RL(0.0);
+
+    // linear interpolation for density
+    LinInterpDensity(x.z, ssp, iSeg, o.rho);
+}
+
 /**
  * Trilinear hexahedral interpolation of SSP data in 3D
  * assumes a rectilinear case (not the most general hexahedral)
@@ -228,9 +320,14 @@ HOST_DEVICE inline void Hexahedral(SSP_3D_FN_ARGS)
         //     x.x, x.y, x.z);
     }
 
-    UpdateSSPSegment(x.x, t.x, ssp->Seg.x, ssp->Nx, iSeg.x);
-    UpdateSSPSegment(x.y, t.y, ssp->Seg.y, ssp->Ny, iSeg.y);
-    UpdateSSPSegment(x.z, t.z, ssp->Seg.z, ssp->Nz, iSeg.z);
+    UpdateSSPSegment(x.x, t.x, ssp->Seg.x, ssp->Nx, ssp->SegInvDelta.x, iSeg.x);
+    UpdateSSPSegment(x.y, t.y, ssp->Seg.y, ssp->Ny, ssp->SegInvDelta.y, iSeg.y);
+    UpdateSSPSegment(x.z, t.z, ssp->Seg.z, ssp->Nz, ssp->SegInvDelta.z, iSeg.z);
+
+    if(ssp->hexCoef != nullptr) {
+        HexahedralCoef(x, o, ssp, iSeg);
+        return;
+    }
 
     // cz at the corners of the current rectangle
     real cz11 = ssp->czMat[((iSeg.x) * ssp->Ny + iSeg.y) * (ssp->Nz - 1) + iSeg.z];
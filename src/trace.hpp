@@ -45,13 +45,11 @@ template<bool O3D> HOST_DEVICE inline void Distances(
 }
 
 /**
- * LP: Not a typo that this is templated on O3D only. In BELLHOP3D, this happens
- * before the Nx2D/3D split, so it is only dependent on the ocean's dimensionality.
+ * LP: Source position and nominal starting direction, see RayStartNominalSSP.
  */
-template<typename CFG, bool O3D> HOST_DEVICE inline SSPOutputs<O3D> RayStartNominalSSP(
-    int32_t isx, int32_t isy, int32_t isz, [[maybe_unused]] real alpha, SSPSegState &iSeg,
-    const Position *Pos, const SSPStructure *ssp, ErrState *errState, VEC23<O3D> &xs,
-    VEC23<O3D> &tinit)
+template<bool O3D> HOST_DEVICE inline void RayStartNominal(
+    int32_t isx, int32_t isy, int32_t isz, [[maybe_unused]] real alpha,
+    const Position *Pos, VEC23<O3D> &xs, VEC23<O3D> &tinit)
 {
     if constexpr(O3D) {
         xs    = vec3(Pos->Sx[isx], Pos->Sy[isy], Pos->Sz[isz]);
@@ -60,18 +58,97 @@ template<typename CFG, bool O3D> HOST_DEVICE inline SSPOutputs<O3D> RayStartNomi
         xs    = vec2(FL(0.0), Pos->Sz[isz]); // x-y [LP: r-z] coordinate of the source
         tinit = vec2(STD::cos(alpha), STD::sin(alpha));
     }
+}
+
+/**
+ * LP: Not a typo that this is templated on O3D only. In BELLHOP3D, this happens
+ * before the Nx2D/3D split, so it is only dependent on the ocean's dimensionality.
+ */
+template<typename CFG, bool O3D> HOST_DEVICE inline SSPOutputs<O3D> RayStartNominalSSP(
+    int32_t isx, int32_t isy, int32_t isz, real alpha, SSPSegState &iSeg,
+    const Position *Pos, const SSPStructure *ssp, ErrState *errState, VEC23<O3D> &xs,
+    VEC23<O3D> &tinit)
+{
+    RayStartNominal<O3D>(isx, isy, isz, alpha, Pos, xs, tinit);
     SSPOutputs<O3D> o;
     // LP: Not a typo that this is templated on O3D only; see function comment.
     EvaluateSSP<CFG, O3D, O3D>(xs, tinit, o, Origin<O3D, O3D>(), ssp, iSeg, errState);
     return o;
 }
 
+/**
+ * LP: Index of the RaySourceCache entry for a ray starting in direction t: the
+ * signs of its first two components (r and z in 2D, x and y in 3D), which are
+ * what the segment searches use to break ties at segment boundaries.
+ */
+template<bool O3D> HOST_DEVICE inline int32_t DirClass(const VEC23<O3D> &t)
+{
+    return (t[0] >= RL(0.0) ? 1 : 0) | (t[1] >= RL(0.0) ? 2 : 0);
+}
+
+template<bool O3D> HOST_DEVICE inline void InitRaySourceCache(RaySourceCache<O3D> *cache)
+{
+    cache->isx = cache->isy = cache->isz = -1;
+    cache->iSegHint.r = cache->iSegHint.x = cache->iSegHint.y = cache->iSegHint.z = 0;
+    cache->topIsegHint = cache->botIsegHint = IORI2<O3D>(0);
+}
+
+/**
+ * LP: RayStartNominalSSP, evaluating the SSP only for the first ray of each
+ * source and DirClass (see RaySourceCache).
+ */
+template<typename CFG, bool O3D> HOST_DEVICE inline SSPOutputs<O3D> RayStartCachedSSP(
+    const RayInitInfo &rinit, SSPSegState &iSeg, const Position *Pos,
+    const SSPStructure *ssp, RaySourceCache<O3D> *cache, ErrState *errState,
+    VEC23<O3D> &xs, VEC23<O3D> &tinit)
+{
+    if(rinit.isz != cache->isz || rinit.isx != cache->isx || rinit.isy != cache->isy) {
+        cache->isx = rinit.isx;
+        cache->isy = rinit.isy;
+        cache->isz = rinit.isz;
+        for(int32_t c = 0; c < 4; ++c) cache->sspValid[c] = cache->bdryValid[c] = false;
+    }
+    RayStartNominal<O3D>(rinit.isx, rinit.isy, rinit.isz, rinit.alpha, Pos, xs, tinit);
+    int32_t c = DirClass<O3D>(tinit);
+    if(!cache->sspValid[c]) {
+        cache->iSeg[c] = cache->iSegHint;
+        EvaluateSSP<CFG, O3D, O3D>(
+            xs, tinit, cache->o[c], Origin<O3D, O3D>(), ssp, cache->iSeg[c], errState);
+        cache->iSegHint    = cache->iSeg[c];
+        cache->sspValid[c] = true;
+    }
+    iSeg = cache->iSeg[c];
+    return cache->o[c];
+}
+
+/**
+ * LP: Locates the boundary segments above and below the source, starting the
+ * searches from the segments already in bds, and the distances to them.
+ */
+template<bool O3D> HOST_DEVICE inline void RayStartBdry(
+    const VEC23<O3D> &xs, const VEC23<O3D> &t, real &DistBegTop, real &DistBegBot,
+    BdryState<O3D> &bds, BdryType &Bdry, const BdryType *ConstBdry,
+    const BdryInfo<O3D> *bdinfo, ErrState *errState)
+{
+    Bdry = *ConstBdry;
+    GetBdrySeg<O3D>(
+        xs, t, bds.top, &bdinfo->top, Bdry.Top, true, true,
+        errState); // identify the top    segment above the source
+    GetBdrySeg<O3D>(
+        xs, t, bds.bot, &bdinfo->bot, Bdry.Bot, false, true,
+        errState); // identify the bottom segment below the source
+
+    Distances<O3D>(
+        xs, bds.top.x, bds.bot.x, bds.top.n, bds.bot.n, DistBegTop, DistBegBot);
+}
+
 /**
  * LP: Pulled out ray update loop initialization. Returns whether to continue
  * with the ray trace. Only call for valid ialpha w.r.t. Angles->iSingleAlpha.
  * Original comments follow.
  *
  * DistBegTop etc.: Distances from ray beginning, end to top and bottom
+ * srcCache: this thread's RaySourceCache, or nullptr to not use one.
  */
 template<typename CFG, bool O3D, bool R3D> HOST_DEVICE inline bool RayInit(
     RayInitInfo &rinit, VEC23<O3D> &xs, rayPt<R3D> &point0, VEC23<O3D> &gradc,
@@ -79,7 +156,8 @@ template<typename CFG, bool O3D, bool R3D> HOST_DEVICE inline bool RayInit(
     BdryState<O3D> &bds, BdryType &Bdry, const BdryType *ConstBdry,
     const BdryInfo<O3D> *bdinfo, const SSPStructure *ssp, const Position *Pos,
     const AnglesStructure *Angles, const FreqInfo *freqinfo,
-    const BeamStructure<O3D> *Beam, const SBPInfo *sbp, ErrState *errState)
+    const BeamStructure<O3D> *Beam, const SBPInfo *sbp, RaySourceCache<O3D> *srcCache,
+    ErrState *errState)
 {
     if(rinit.isz < 0 || rinit.isz >= Pos->NSz || rinit.ialpha < 0
        || rinit.ialpha >= Angles->alpha.n
@@ -104,11 +182,17 @@ template<typename CFG, bool O3D, bool R3D> HOST_DEVICE inline bool RayInit(
         rinit.beta = rinit.SrcAzimAngle = NAN;
     }
 
-    iSeg.x = iSeg.y = iSeg.z = iSeg.r = 0;
     VEC23<O3D> tinit;
-    SSPOutputs<O3D> o = RayStartNominalSSP<CFG, O3D>(
-        rinit.isx, rinit.isy, rinit.isz, rinit.alpha, iSeg, Pos, ssp, errState, xs,
-        tinit);
+    SSPOutputs<O3D> o;
+    if(srcCache != nullptr) {
+        o = RayStartCachedSSP<CFG, O3D>(
+            rinit, iSeg, Pos, ssp, srcCache, errState, xs, tinit);
+    } else {
+        iSeg.x = iSeg.y = iSeg.z = iSeg.r = 0;
+        o = RayStartNominalSSP<CFG, O3D>(
+            rinit.isx, rinit.isy, rinit.isz, rinit.alpha, iSeg, Pos, ssp, errState, xs,
+            tinit);
+    }
     gradc = o.gradc;
 
     if constexpr(O3D && !R3D) {
@@ -197,22 +281,34 @@ template<typename CFG, bool O3D, bool R3D> HOST_DEVICE inline bool RayInit(
         if(Beam->RunType[1] == 'G') point0.q = vec2(FL(0.0), FL(0.0));
     }
 
-    Bdry = *ConstBdry;
-    if constexpr(O3D) {
-        bds.top.Iseg.x = bds.top.Iseg.y = 0;
-        bds.bot.Iseg.x = bds.bot.Iseg.y = 0;
+    VEC23<O3D> t_o = RayToOceanT(point0.t, org);
+    if(srcCache != nullptr) {
+        int32_t c = DirClass<O3D>(t_o);
+        if(!srcCache->bdryValid[c]) {
+            BdryState<O3D> &cbds = srcCache->bds[c];
+            cbds.top.Iseg        = srcCache->topIsegHint;
+            cbds.bot.Iseg        = srcCache->botIsegHint;
+            RayStartBdry<O3D>(
+                xs, t_o, srcCache->DistBegTop[c], srcCache->DistBegBot[c], cbds,
+                srcCache->Bdry[c], ConstBdry, bdinfo, errState);
+            srcCache->topIsegHint  = cbds.top.Iseg;
+            srcCache->botIsegHint  = cbds.bot.Iseg;
+            srcCache->bdryValid[c] = true;
+        }
+        bds        = srcCache->bds[c];
+        Bdry       = srcCache->Bdry[c];
+        DistBegTop = srcCache->DistBegTop[c];
+        DistBegBot = srcCache->DistBegBot[c];
     } else {
-        bds.top.Iseg = bds.bot.Iseg = 0;
+        if constexpr(O3D) {
+            bds.top.Iseg.x = bds.top.Iseg.y = 0;
+            bds.bot.Iseg.x = bds.bot.Iseg.y = 0;
+        } else {
+            bds.top.Iseg = bds.bot.Iseg = 0;
+        }
+        RayStartBdry<O3D>(
+            xs, t_o, DistBegTop, DistBegBot, bds, Bdry, ConstBdry, bdinfo, errState);
     }
-    GetBdrySeg<O3D>(
-        xs, RayToOceanT(point0.t, org), bds.top, &bdinfo->top, Bdry.Top, true, true,
-        errState); // identify the top    segment above the source
-    GetBdrySeg<O3D>(
-        xs, RayToOceanT(point0.t, org), bds.bot, &bdinfo->bot, Bdry.Bot, false, true,
-        errState); // identify the bottom segment below the source
-
-    Distances<O3D>(
-        xs, bds.top.x, bds.bot.x, bds.top.n, bds.bot.n, DistBegTop, DistBegBot);
 
     if(DistBegTop <= FL(0.0) || DistBegBot <= FL(0.0)) {
         RunWarning(errState, BHC_WARN_SOURCE_OUTSIDE_BOUNDARIES);
@@ -478,13 +574,20 @@ template<bool O3D, bool R3D> HOST_DEVICE inline bool RayTerminate(
 
 /**
  * Main ray tracing function for ray path output mode.
+ *
+ * ray initially has room for capacity points. When more are needed,
+ * grow(ray, capacity, npoints) is called, which must move the first npoints
+ * points to a larger buffer and update ray and capacity, or return false if
+ * there is no more memory (in which case Nsteps is set to 0).
  */
-template<typename CFG, bool O3D, bool R3D> HOST_DEVICE inline void MainRayMode(
-    RayInitInfo &rinit, rayPt<R3D> *ray, int32_t &Nsteps, int32_t MaxPointsPerRay,
-    Origin<O3D, R3D> &org, const BdryType *ConstBdry, const BdryInfo<O3D> *bdinfo,
-    const ReflectionInfo *refl, const SSPStructure *ssp, const Position *Pos,
-    const AnglesStructure *Angles, const FreqInfo *freqinfo,
-    const BeamStructure<O3D> *Beam, const SBPInfo *sbp, ErrState *errState)
+template<typename CFG, bool O3D, bool R3D, typename GROW> HOST_DEVICE inline void
+MainRayMode(
+    RayInitInfo &rinit, rayPt<R3D> *&ray, int32_t &Nsteps, int32_t MaxPointsPerRay,
+    int32_t capacity, GROW &&grow, Origin<O3D, R3D> &org, const BdryType *ConstBdry,
+    const BdryInfo<O3D> *bdinfo, const ReflectionInfo *refl, const SSPStructure *ssp,
+    const Position *Pos, const AnglesStructure *Angles, const FreqInfo *freqinfo,
+    const BeamStructure<O3D> *Beam, const SBPInfo *sbp, RaySourceCache<O3D> *srcCache,
+    ErrState *errState)
 {
     real DistBegTop, DistEndTop, DistBegBot, DistEndBot;
     SSPSegState iSeg;
@@ -494,7 +597,8 @@ template<typename CFG, bool O3D, bool R3D> HOST_DEVICE inline void MainRayMode(
 
     if(!RayInit<CFG, O3D, R3D>(
            rinit, xs, ray[0], gradc, DistBegTop, DistBegBot, org, iSeg, bds, Bdry,
-           ConstBdry, bdinfo, ssp, Pos, Angles, freqinfo, Beam, sbp, errState)) {
+           ConstBdry, bdinfo, ssp, Pos, Angles, freqinfo, Beam, sbp, srcCache,
+           errState)) {
         Nsteps = 1;
         return;
     }
@@ -504,6 +608,10 @@ template<typename CFG, bool O3D, bool R3D> HOST_DEVICE inline void MainRayMode(
 
     while(true) {
         if(HasErrored(errState)) break;
+        if(is + 3 > capacity && !grow(ray, capacity, is + 1)) {
+            Nsteps = 0;
+            return;
+        }
         bool twoSteps = RayUpdate<CFG, O3D, R3D>(
             ray[is], ray[is + 1], ray[is + 2], DistEndTop, DistEndBot, iSmallStepCtr, org,
             iSeg, bds, Bdry, bdinfo, refl, ssp, freqinfo, Beam, xs, errState);
@@ -520,72 +628,195 @@ template<typename CFG, bool O3D, bool R3D> HOST_DEVICE inline void MainRayMode(
 }
 
 /**
- * Main ray tracing function for TL, eigen, and arrivals runs.
+ * LP: State of one ray being traced in a field mode (TL, eigen, arrivals),
+ * between calls to FieldRayStep. These were the locals of MainFieldModes;
+ * they are in a struct so that ReplayFieldModes can share the setup and
+ * per-step code with MainFieldModes.
  */
-template<typename CFG, bool O3D, bool R3D> HOST_DEVICE inline void MainFieldModes(
-    RayInitInfo &rinit, cpxf *uAllSources, const BdryType *ConstBdry,
-    const BdryInfo<O3D> *bdinfo, const ReflectionInfo *refl, const SSPStructure *ssp,
-    const Position *Pos, const AnglesStructure *Angles, const FreqInfo *freqinfo,
-    const BeamStructure<O3D> *Beam, const SBPInfo *sbp, EigenInfo *eigen,
-    const ArrInfo *arrinfo, ErrState *errState)
-{
+template<bool O3D, bool R3D> struct FieldRayState {
     real DistBegTop, DistEndTop, DistBegBot, DistEndBot;
     SSPSegState iSeg;
     VEC23<O3D> xs, gradc;
     BdryState<O3D> bds;
     BdryType Bdry;
     Origin<O3D, R3D> org;
-
     rayPt<R3D> point0, point1, point2;
-    point2.c = NAN; // Silence incorrect g++ warning about maybe uninitialized;
-    // it is always set when doing two steps, and not used otherwise
     InfluenceRayInfo<R3D> inflray;
+    int32_t iSmallStepCtr;
+    int32_t is;      // index for a step along the ray
+    int32_t Nsteps;  // not actually needed in TL mode, debugging only
+    int32_t nPoints; // LP: Points computed so far, for eigenRay
+};
+
+/**
+ * Initializes the ray for MainFieldModes. Returns false if the ray is not to
+ * be traced (e.g. it starts outside the boundaries).
+ *
+ * Parameters: see MainFieldModes.
+ */
+template<typename CFG, bool O3D, bool R3D> HOST_DEVICE inline bool FieldRayStart(
+    FieldRayState<O3D, R3D> &st, RayInitInfo &rinit, bool uPrivate,
+    const BdryType *ConstBdry, const BdryInfo<O3D> *bdinfo, const SSPStructure *ssp,
+    const Position *Pos, const AnglesStructure *Angles, const FreqInfo *freqinfo,
+    const BeamStructure<O3D> *Beam, const SBPInfo *sbp, ArrHitCursor *arrCursor,
+    RaySourceCache<O3D> *srcCache, RayResult<O3D, R3D> *eigenRay, ErrState *errState)
+{
+    st.point2.c = NAN; // Silence incorrect g++ warning about maybe uninitialized;
+    // it is always set when doing two steps, and not used otherwise
+    if(eigenRay != nullptr) eigenRay->Nsteps = 0;
 
     if(!RayInit<CFG, O3D, R3D>(
-           rinit, xs, point0, gradc, DistBegTop, DistBegBot, org, iSeg, bds, Bdry,
-           ConstBdry, bdinfo, ssp, Pos, Angles, freqinfo, Beam, sbp, errState)) {
-        return;
+           rinit, st.xs, st.point0, st.gradc, st.DistBegTop, st.DistBegBot, st.org,
+           st.iSeg, st.bds, st.Bdry, ConstBdry, bdinfo, ssp, Pos, Angles, freqinfo, Beam,
+           sbp, srcCache, errState)) {
+        return false;
     }
 
     Init_Influence<CFG, O3D, R3D>(
-        inflray, point0, rinit, gradc, Pos, org, ssp, iSeg, Angles, freqinfo, Beam,
-        errState);
-
-    int32_t iSmallStepCtr = 0;
-    int32_t is            = 0; // index for a step along the ray
-    int32_t Nsteps        = 0; // not actually needed in TL mode, debugging only
+        st.inflray, st.point0, rinit, st.gradc, Pos, st.org, ssp, st.iSeg, Angles,
+        freqinfo, Beam, errState);
+    st.inflray.uPrivate       = uPrivate;
+    st.inflray.arrCursor      = arrCursor;
+    st.inflray.eigenMaxPoints = 0;
+
+    st.iSmallStepCtr = 0;
+    st.is            = 0;
+    st.Nsteps        = 0;
+    st.nPoints       = 1;
+    if(eigenRay != nullptr) eigenRay->ray[0] = st.point0;
+    return true;
+}
 
-    while(true) {
-        if(HasErrored(errState)) break;
-        bool twoSteps = RayUpdate<CFG, O3D, R3D>(
-            point0, point1, point2, DistEndTop, DistEndBot, iSmallStepCtr, org, iSeg, bds,
-            Bdry, bdinfo, refl, ssp, freqinfo, Beam, xs, errState);
-        if(!Step_Influence<CFG, O3D, R3D>(
-               point0, point1, inflray, is, uAllSources, ConstBdry, org, ssp, iSeg, Pos,
-               Beam, eigen, arrinfo, errState)) {
+/**
+ * Advances the ray by one ray update (one or two steps) and applies their
+ * influence. Returns false when the ray has terminated.
+ *
+ * Parameters: see MainFieldModes.
+ */
+template<typename CFG, bool O3D, bool R3D> HOST_DEVICE inline bool FieldRayStep(
+    FieldRayState<O3D, R3D> &st, cpxf *uAllSources, const BdryType *ConstBdry,
+    const BdryInfo<O3D> *bdinfo, const ReflectionInfo *refl, const SSPStructure *ssp,
+    const Position *Pos, const FreqInfo *freqinfo, const BeamStructure<O3D> *Beam,
+    EigenInfo *eigen, const ArrInfo *arrinfo, RayResult<O3D, R3D> *eigenRay,
+    ErrState *errState)
+{
+    if(HasErrored(errState)) return false;
+    bool twoSteps = RayUpdate<CFG, O3D, R3D>(
+        st.point0, st.point1, st.point2, st.DistEndTop, st.DistEndBot, st.iSmallStepCtr,
+        st.org, st.iSeg, st.bds, st.Bdry, bdinfo, refl, ssp, freqinfo, Beam, st.xs,
+        errState);
+    if(eigenRay != nullptr) {
+        eigenRay->ray[st.is + 1] = st.point1;
+        if(twoSteps) eigenRay->ray[st.is + 2] = st.point2;
+        st.nPoints = st.is + (twoSteps ? 3 : 2);
+    }
+    // LP: A re-trace (MainRayMode with Nsteps = is of the hit) stops after
+    // the first update which starts at or after the hit.
+    st.inflray.eigenStepPoints = 2;
+    if(!Step_Influence<CFG, O3D, R3D>(
+           st.point0, st.point1, st.inflray, st.is, uAllSources, ConstBdry, st.org, ssp,
+           st.iSeg, Pos, Beam, eigen, arrinfo, errState)) {
 #ifdef STEP_DEBUGGING
-            printf("Step_Influence terminated ray\n");
+        printf("Step_Influence terminated ray\n");
 #endif
-            break;
-        }
-        ++is;
-        if(twoSteps) {
-            if(!Step_Influence<CFG, O3D, R3D>(
-                   point1, point2, inflray, is, uAllSources, ConstBdry, org, ssp, iSeg,
-                   Pos, Beam, eigen, arrinfo, errState))
-                break;
-            point0 = point2;
-            ++is;
-        } else {
-            point0 = point1;
-        }
-        if(RayTerminate<O3D, R3D>(
-               point0, Nsteps, is, xs, iSmallStepCtr, DistBegTop, DistBegBot, DistEndTop,
-               DistEndBot, MaxN, org, bdinfo, Beam, errState))
-            break;
+        return false;
+    }
+    ++st.is;
+    if(twoSteps) {
+        st.inflray.eigenStepPoints = 3;
+        if(!Step_Influence<CFG, O3D, R3D>(
+               st.point1, st.point2, st.inflray, st.is, uAllSources, ConstBdry, st.org,
+               ssp, st.iSeg, Pos, Beam, eigen, arrinfo, errState))
+            return false;
+        st.point0 = st.point2;
+        ++st.is;
+    } else {
+        st.point0 = st.point1;
+    }
+    return !RayTerminate<O3D, R3D>(
+        st.point0, st.Nsteps, st.is, st.xs, st.iSmallStepCtr, st.DistBegTop,
+        st.DistBegBot, st.DistEndTop, st.DistEndBot, MaxN, st.org, bdinfo, Beam,
+        errState);
+}
+
+/**
+ * Finishes the ray after FieldRayStep returns false.
+ */
+template<bool O3D, bool R3D> HOST_DEVICE inline void FieldRayFinish(
+    const FieldRayState<O3D, R3D> &st, const RayInitInfo &rinit,
+    RayResult<O3D, R3D> *eigenRay)
+{
+    if(eigenRay != nullptr && st.inflray.eigenMaxPoints > 0) {
+        eigenRay->org          = st.org;
+        eigenRay->SrcDeclAngle = rinit.SrcDeclAngle;
+        eigenRay->Nsteps       = bhc::min(st.inflray.eigenMaxPoints, st.nPoints);
+    }
+    // printf("Nsteps %d\n", st.Nsteps);
+}
+
+/**
+ * Main ray tracing function for TL, eigen, and arrivals runs.
+ *
+ * uPrivate: uAllSources is only written by this thread (see FieldTiles), so
+ * contributions can be added without atomics.
+ * arrCursor: this thread's recorded hits, for multithreaded arrivals runs on
+ * the CPU (see AddArr).
+ * srcCache: this thread's RaySourceCache, or nullptr (see RayInit).
+ * eigenRay: single-pass eigenrays only, otherwise nullptr. The ray's points
+ * are written to eigenRay->ray (MaxN points), and on return eigenRay->Nsteps
+ * is the number of points needed by the eigen hits on this ray (0 if none).
+ */
+template<typename CFG, bool O3D, bool R3D> HOST_DEVICE inline void MainFieldModes(
+    RayInitInfo &rinit, cpxf *uAllSources, bool uPrivate, const BdryType *ConstBdry,
+    const BdryInfo<O3D> *bdinfo, const ReflectionInfo *refl, const SSPStructure *ssp,
+    const Position *Pos, const AnglesStructure *Angles, const FreqInfo *freqinfo,
+    const BeamStructure<O3D> *Beam, const SBPInfo *sbp, EigenInfo *eigen,
+    const ArrInfo *arrinfo, ArrHitCursor *arrCursor, RaySourceCache<O3D> *srcCache,
+    RayResult<O3D, R3D> *eigenRay, ErrState *errState)
+{
+    FieldRayState<O3D, R3D> st;
+    if(!FieldRayStart<CFG, O3D, R3D>(
+           st, rinit, uPrivate, ConstBdry, bdinfo, ssp, Pos, Angles, freqinfo, Beam, sbp,
+           arrCursor, srcCache, eigenRay, errState)) {
+        return;
     }
+    while(FieldRayStep<CFG, O3D, R3D>(
+        st, uAllSources, ConstBdry, bdinfo, refl, ssp, Pos, freqinfo, Beam, eigen,
+        arrinfo, eigenRay, errState)) {}
+    FieldRayFinish<O3D, R3D>(st, rinit, eigenRay);
+}
 
-    // printf("Nsteps %d\n", Nsteps);
+/**
+ * Version of MainFieldModes for a ray already traced into the ray fan (see
+ * bhcInit::reuseRayFan): applies the influence of each step of the stored ray
+ * to the receivers, without stepping it again. TL and arrivals runs only.
+ *
+ * LP: The ray is the same as MainFieldModes would trace, as RayUpdate does not
+ * depend on the run type. Only the influence state is initialized again; the
+ * SSP segment in st.iSeg is just a starting point for the searches in the
+ * influence (Cerveny beams), so it is fine for it to lag behind the ray.
+ */
+template<typename CFG, bool O3D, bool R3D> HOST_DEVICE inline void ReplayFieldModes(
+    RayInitInfo &rinit, const RayResult<O3D, R3D> *fanRay, cpxf *uAllSources,
+    bool uPrivate, const BdryType *ConstBdry, const BdryInfo<O3D> *bdinfo,
+    const SSPStructure *ssp, const Position *Pos, const AnglesStructure *Angles,
+    const FreqInfo *freqinfo, const BeamStructure<O3D> *Beam, const SBPInfo *sbp,
+    const ArrInfo *arrinfo, ArrHitCursor *arrCursor, RaySourceCache<O3D> *srcCache,
+    ErrState *errState)
+{
+    FieldRayState<O3D, R3D> st;
+    if(!FieldRayStart<CFG, O3D, R3D>(
+           st, rinit, uPrivate, ConstBdry, bdinfo, ssp, Pos, Angles, freqinfo, Beam, sbp,
+           arrCursor, srcCache, nullptr, errState)) {
+        return;
+    }
+    for(int32_t is = 0; is < fanRay->Nsteps - 1; ++is) {
+        if(HasErrored(errState)) return;
+        if(!Step_Influence<CFG, O3D, R3D>(
+               fanRay->ray[is], fanRay->ray[is + 1], st.inflray, is, uAllSources,
+               ConstBdry, st.org, ssp, st.iSeg, Pos, Beam, nullptr, arrinfo, errState))
+            return;
+    }
 }
 
 } // namespace bhc
@@ -88,6 +88,22 @@ public:
         write(file, fline, &v, sizeof(T));
     }
 
+    size_t reclen() const { return recl; }
+
+    /**
+     * Write n whole records starting at record r in one sequential write. data
+     * must be n * reclen() bytes, with each record already padded.
+     */
+    void writerecs(size_t r, const void *data, size_t n)
+    {
+        if(n == 0) return;
+        rec(r + n - 1);
+        ostr.seekp(r * recl);
+        ostr.write((const char *)data, n * recl);
+        bytesWrittenThisRecord = recl;
+        if(record == highestRecord) bytesWrittenHighestRecord = recl;
+    }
+
 private:
     bhcInternal *_internal;
     std::ofstream ostr;
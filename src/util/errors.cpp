@@ -68,6 +68,9 @@ static const char *const errorDescriptions[BHC_ERR_MAX] = {
     "BHC_ERR_QUAD_ISEG: SSP segment index in quad SSP has become invalid",
     "BHC_ERR_INVALID_IMAGE_INDEX: Cerveny beam image index has become invalid, "
     "will happen if Nimage is invalid (must be 1, 2, or 3)",
+    "BHC_ERR_CANCELLED: Run was cancelled by bhc::cancel; outputs are incomplete",
+    "BHC_ERR_ARRHITS_WRITE: Could not write the arrivals to the temporary file used "
+    "to merge them from multiple threads (out of disk space?)",
 };
 
 static const char *const warningDescriptions[BHC_WARN_MAX] = {
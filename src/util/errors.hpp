@@ -69,7 +69,9 @@ extern void CheckReportErrors(bhcInternal *internal, const ErrState *errState);
 #define BHC_ERR_OUTSIDE_SSP 8
 #define BHC_ERR_QUAD_ISEG 9
 #define BHC_ERR_INVALID_IMAGE_INDEX 10
-#define BHC_ERR_MAX 11
+#define BHC_ERR_CANCELLED 11
+#define BHC_ERR_ARRHITS_WRITE 12
+#define BHC_ERR_MAX 13
 
 #define BHC_WARN_RAYS_OUTOFMEMORY 0
 #define BHC_WARN_ONERAY_OUTOFMEMORY 1
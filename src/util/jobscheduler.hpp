@@ -0,0 +1,132 @@
+/*
+bellhopcxx / bellhopcuda - C++/CUDA port of BELLHOP(3D) underwater acoustics simulator
+Copyright (C) 2021-2023 The Regents of the University of California
+Marine Physical Lab at Scripps Oceanography, c/o Jules Jaffe, jjaffe@ucsd.edu
+Based on BELLHOP / BELLHOP3D, which is Copyright (C) 1983-2022 Michael B. Porter
+
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#ifndef _BHC_INCLUDING_COMPONENTS_
+#error "Must be included from common.hpp!"
+#endif
+
+namespace bhc {
+
+/**
+ * Distributes job numbers 0 to numJobs - 1 (see GetNumJobs / GetJobIndices) to
+ * the CPU worker threads, without every thread contending on a single shared
+ * counter.
+ *
+ * Each worker starts with a contiguous range of jobs, which it takes from the
+ * front of in chunks whose size shrinks as the range is used up. When a worker
+ * runs out, it steals the back half of another worker's remaining range. This
+ * keeps the load balanced when some rays run to MaxN steps and others
+ * terminate almost immediately. With one worker, jobs are handed out in
+ * ascending order, the same as the original shared counter.
+ *
+ * Each range is a [begin, end) pair packed into one 64-bit atomic, so the
+ * owner and thieves can both update it with a single compare-exchange.
+ *
+ * The jobs may also be groups of rays (see FieldTiles), in which case the
+ * stealing is at that granularity.
+ */
+class JobScheduler {
+public:
+    JobScheduler(int32_t numWorkers_) : numWorkers(numWorkers_), slots(numWorkers_) {}
+
+    /// Not thread safe; call before dispatching the workers.
+    inline void Reset(int32_t numJobs)
+    {
+        for(int32_t w = 0; w < numWorkers; ++w) {
+            int32_t b = (int32_t)((int64_t)numJobs * w / numWorkers);
+            int32_t e = (int32_t)((int64_t)numJobs * (w + 1) / numWorkers);
+            slots[w].range.store(Pack(b, e), std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    /**
+     * Get the next chunk of jobs [first, last) for this worker. Returns false
+     * once there are no jobs left for any worker.
+     */
+    inline bool Next(int32_t worker, int32_t &first, int32_t &last)
+    {
+        if(PopFront(worker, first, last)) return true;
+        for(int32_t i = 1; i < numWorkers; ++i) {
+            if(Steal((worker + i) % numWorkers, worker)) {
+                if(PopFront(worker, first, last)) return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    // Chunk is this fraction of the worker's remaining range, up to maxChunk.
+    static constexpr int32_t chunkDivisor = 8;
+    static constexpr int32_t maxChunk     = 32;
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> range;
+    };
+
+    static inline uint64_t Pack(int32_t b, int32_t e)
+    {
+        return ((uint64_t)(uint32_t)b << 32) | (uint64_t)(uint32_t)e;
+    }
+    static inline int32_t Begin(uint64_t r) { return (int32_t)(uint32_t)(r >> 32); }
+    static inline int32_t End(uint64_t r) { return (int32_t)(uint32_t)r; }
+
+    inline bool PopFront(int32_t worker, int32_t &first, int32_t &last)
+    {
+        std::atomic<uint64_t> &range = slots[worker].range;
+        uint64_t r                   = range.load(std::memory_order_acquire);
+        while(true) {
+            int32_t b = Begin(r), e = End(r);
+            if(b >= e) return false;
+            int32_t n = std::min(std::max((e - b) / chunkDivisor, 1), maxChunk);
+            if(range.compare_exchange_weak(
+                   r, Pack(b + n, e), std::memory_order_acq_rel,
+                   std::memory_order_acquire)) {
+                first = b;
+                last  = b + n;
+                return true;
+            }
+        }
+    }
+
+    inline bool Steal(int32_t victim, int32_t thief)
+    {
+        std::atomic<uint64_t> &range = slots[victim].range;
+        uint64_t r                   = range.load(std::memory_order_acquire);
+        while(true) {
+            int32_t b = Begin(r), e = End(r);
+            if(b >= e) return false;
+            int32_t n = (e - b + 1) / 2;
+            if(range.compare_exchange_weak(
+                   r, Pack(b, e - n), std::memory_order_acq_rel,
+                   std::memory_order_acquire)) {
+                // Thief's own range is empty, so nobody else can be taking
+                // from it; a plain store is enough.
+                slots[thief].range.store(Pack(e - n, e), std::memory_order_release);
+                return true;
+            }
+        }
+    }
+
+    int32_t numWorkers;
+    std::vector<Slot> slots;
+};
+
+} // namespace bhc
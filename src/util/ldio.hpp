@@ -42,8 +42,9 @@ namespace bhc {
 class LDIFile {
 public:
     LDIFile(bhcInternal *internal, bool abort_on_error = true)
-        : _internal(internal), _abort_on_error(abort_on_error), lastitemcount(0), line(0),
-          isafterslash(false), isafternewline(true)
+        : _internal(internal), _abort_on_error(abort_on_error), isopen(false), pos(0),
+          iseof(false), lastitemcount(0), line(0), isafterslash(false),
+          isafternewline(true)
     {}
 
     LDIFile(
@@ -53,37 +54,64 @@ public:
         open(filename);
     }
 
+    /**
+     * LP: The whole file is read into memory at once and tokenized from there,
+     * rather than going through iostreams one character at a time.
+     */
     void open(const std::string &filename)
     {
         _filename = filename;
-        f.open(filename);
-        if(!f.good()) Error("Failed to open file");
+        buf.clear();
+        pos    = 0;
+        iseof  = false;
+        isopen = false;
+        std::ifstream f(filename, std::ios::binary);
+        if(f.good()) {
+            f.seekg(0, std::ios::end);
+            std::streamoff size = f.tellg();
+            f.seekg(0, std::ios::beg);
+            if(size > 0) {
+                buf.resize((size_t)size);
+                f.read(&buf[0], size);
+            }
+            isopen = !f.fail();
+        }
+        if(!isopen) Error("Failed to open file");
+#ifdef _WIN32
+        // LP: Same as reading in text mode.
+        size_t o = 0;
+        for(size_t i = 0; i < buf.size(); ++i) {
+            if(buf[i] == '\r' && i + 1 < buf.size() && buf[i + 1] == '\n') continue;
+            buf[o++] = buf[i];
+        }
+        buf.resize(o);
+#endif
         ++line;
-        // automatically closed when ifstream destroyed
     }
 
-    bool Good() { return f.good(); }
+    bool Good() { return isopen && !iseof; }
 
     struct State {
-        std::streampos s;
+        size_t s;
         int l;
     };
     State StateSave()
     {
         isafterslash = false;
         if(!isafternewline) { IgnoreRestOfLine(); }
-        return {f.tellg(), line};
+        return {pos, line};
     }
 
     void StateLoad(const State &s)
     {
         isafterslash   = false;
         isafternewline = true;
-        f.seekg(s.s);
-        line = s.l;
+        iseof          = false;
+        pos            = s.s;
+        line           = s.l;
     }
 
-    bool EndOfFile() { return f.eof(); }
+    bool EndOfFile() { return iseof; }
 
 #define LIST(ldif) ldif.List(__FILE__, __LINE__)
 #define LIST_WARNLINE(ldif) ldif.List(__FILE__, __LINE__, true)
@@ -101,9 +129,9 @@ public:
     }
 
 #define LDIFILE_READPREFIX() \
-    if(f.eof() && !isafterslash) Error("End of file"); \
-    std::string s = GetNextItem(); \
-    if(s == nullitem) return; \
+    if(iseof && !isafterslash) Error("End of file"); \
+    const std::string &s = GetNextItem(); \
+    if(IsNull(s)) return; \
     REQUIRESEMICOLON
 
     void Read(std::string &v)
@@ -132,41 +160,27 @@ public:
     void Read(float &v)
     {
         LDIFILE_READPREFIX();
-        if(!isReal(s)) Error("String " + s + " is not a real number");
-        v = strtof(s.c_str(), nullptr);
+        char *end;
+        v = strtof(s.c_str(), &end);
+        if(s.empty() || *end != '\0') Error("String " + s + " is not a real number");
     }
     void Read(double &v)
     {
         LDIFILE_READPREFIX();
-        if(!isReal(s)) Error("String " + s + " is not a real number");
-        v = strtod(s.c_str(), nullptr);
+        if(!ParseDouble(s, v)) Error("String " + s + " is not a real number");
     }
     void Read(vec2 &v)
     {
         LDIFILE_READPREFIX();
-        if(!isReal(s)) Error("String " + s + " is not a real number");
-        v.x = strtod(s.c_str(), nullptr);
-        if(f.eof() && !isafterslash) Error("End of file");
-        s = GetNextItem();
-        if(s == nullitem) Error("Only specified part of a vec2!");
-        if(!isReal(s)) Error("String " + s + " is not a real number");
-        v.y = strtod(s.c_str(), nullptr);
+        v.x = ParseComponent(s);
+        v.y = ReadNextComponent("Only specified part of a vec2!");
     }
     void Read(vec3 &v)
     {
         LDIFILE_READPREFIX();
-        if(!isReal(s)) Error("String " + s + " is not a real number");
-        v.x = strtod(s.c_str(), nullptr);
-        if(f.eof() && !isafterslash) Error("End of file");
-        s = GetNextItem();
-        if(s == nullitem) Error("Only specified part of a vec3!");
-        if(!isReal(s)) Error("String " + s + " is not a real number");
-        v.y = strtod(s.c_str(), nullptr);
-        if(f.eof() && !isafterslash) Error("End of file");
-        s = GetNextItem();
-        if(s == nullitem) Error("Only specified part of a vec3!");
-        if(!isReal(s)) Error("String " + s + " is not a real number");
-        v.z = strtod(s.c_str(), nullptr);
+        v.x = ParseComponent(s);
+        v.y = ReadNextComponent("Only specified part of a vec3!");
+        v.z = ReadNextComponent("Only specified part of a vec3!");
     }
     void Read(cpx &v)
     {
@@ -180,12 +194,11 @@ public:
         std::string sr, si;
         sr = s.substr(1, commapos - 1);
         si = s.substr(commapos + 1, s.length() - commapos - 2);
-        if(!isReal(sr) || !isReal(si))
+        double vr, vi;
+        if(!ParseDouble(sr, vr) || !ParseDouble(si, vi))
             Error(
                 "String " + s + " is not a complex number (components not real numbers)");
-        real vr = strtod(sr.c_str(), nullptr);
-        real vi = strtod(si.c_str(), nullptr);
-        v       = cpx(vr, vi);
+        v = cpx((real)vr, (real)vi);
     }
     void Read(char *v, size_t nc)
     {
@@ -201,6 +214,49 @@ public:
     }
 
 private:
+    /**
+     * LP: Validates and converts in a single strtod call. This accepts exactly
+     * what isReal accepts; std::from_chars is not used because its grammar is
+     * different (no leading '+' or whitespace, no hex floats).
+     */
+    static bool ParseDouble(const std::string &s, double &v)
+    {
+        if(s.empty()) return false;
+        char *end;
+        v = strtod(s.c_str(), &end);
+        return *end == '\0';
+    }
+    double ParseComponent(const std::string &s)
+    {
+        double v = 0.0;
+        if(!ParseDouble(s, v)) Error("String " + s + " is not a real number");
+        return v;
+    }
+    double ReadNextComponent(const char *partialmsg)
+    {
+        if(iseof && !isafterslash) Error("End of file");
+        const std::string &s = GetNextItem();
+        if(IsNull(s)) Error(partialmsg);
+        return ParseComponent(s);
+    }
+
+    // LP: Same semantics as std::istream peek() / get(), including that EOF is
+    // only flagged once a read past the end is attempted.
+    int Peek()
+    {
+        if(pos < buf.size()) return (unsigned char)buf[pos];
+        iseof = true;
+        return EOF;
+    }
+    void Get()
+    {
+        if(pos < buf.size()) {
+            ++pos;
+        } else {
+            iseof = true;
+        }
+    }
+
     void PrintLoc()
     {
         ExternalWarning(
@@ -217,18 +273,25 @@ private:
     void IgnoreRestOfLine()
     {
         if(_debug) ExternalWarning(_internal, "-- ignoring rest of line\n");
-        f.peek();
-        if(f.eof()) Error("End of file");
-        while(true) {
-            int c = f.peek();
-            if(f.eof() || c == '\n') break;
-            f.get();
+        Peek();
+        if(iseof) Error("End of file");
+        const char *nl = (const char *)memchr(&buf[pos], '\n', buf.size() - pos);
+        if(nl == nullptr) {
+            pos   = buf.size();
+            iseof = true;
+        } else {
+            pos = (size_t)(nl - buf.data()) + 1; // get the \n
         }
-        if(!f.eof()) f.get(); // get the \n
         ++line;
         isafternewline = true;
     }
-    std::string GetNextItem()
+    static const std::string &NullItem()
+    {
+        static const std::string n(nullitem);
+        return n;
+    }
+    static bool IsNull(const std::string &s) { return &s == &NullItem(); }
+    const std::string &GetNextItem()
     {
         if(lastitemcount > 0) {
             --lastitemcount;
@@ -239,14 +302,14 @@ private:
         }
         if(isafterslash) {
             if(_debug) ExternalWarning(_internal, "-- isafterslash, returning null\n");
-            return nullitem;
+            return NullItem();
         }
         // Whitespace before start of item
         while(true) {
-            int c = f.peek();
-            if(f.eof()) break;
+            int c = Peek();
+            if(iseof) break;
             if(!isspace(c)) break;
-            f.get();
+            Get();
             if(c == '\n') {
                 ++line;
                 isafternewline = true;
@@ -254,12 +317,12 @@ private:
                 isafternewline = false;
             }
         }
-        if(f.eof()) return nullitem;
-        if(f.peek() == ',') {
-            f.get();
+        if(iseof) return NullItem();
+        if(Peek() == ',') {
+            Get();
             isafternewline = false;
             if(_debug) ExternalWarning(_internal, "-- empty comma, returning null\n");
-            return nullitem;
+            return NullItem();
         }
         // Main item
         if(_warnline >= 0 && _warnline != line) {
@@ -268,12 +331,12 @@ private:
                 _internal, "Warning: input continues onto next line, likely mistake\n");
             _warnline = line;
         }
-        lastitem      = "";
+        lastitem.clear();
         int quotemode = 0;
         while(true) {
-            int c = f.peek();
-            if(f.eof()) break;
-            f.get();
+            int c = Peek();
+            if(iseof) break;
+            Get();
             isafternewline = false;
             if(quotemode == 1) {
                 if(c == '"') {
@@ -325,7 +388,7 @@ private:
                     if(!isInt(lastitem, false)) Error("Invalid repetition count");
                     lastitemcount = std::stoul(lastitem);
                     if(lastitemcount == 0) Error("Repetition count can't be 0");
-                    lastitem = "";
+                    lastitem.clear();
                 } else if(c == '/') {
                     isafterslash = true;
                     break;
@@ -335,13 +398,13 @@ private:
             }
         }
         if(quotemode > 0) Error("Quotes or parentheses not closed");
-        if(f.eof()) {
+        if(iseof) {
             if(_debug)
                 ExternalWarning(_internal, "-- eof, returning %s\n", lastitem.c_str());
             return lastitem;
         }
         if(quotemode < 0) {
-            int c = f.peek();
+            int c = Peek();
             if(!isspace(c) && c != ',')
                 Error(
                     std::string("Invalid character '") + (char)c
@@ -362,10 +425,10 @@ private:
         // Whitespace and comma after item
         bool hadcomma = false;
         while(true) {
-            int c = f.peek();
-            if(f.eof()) break;
+            int c = Peek();
+            if(iseof) break;
             if(isspace(c)) {
-                f.get();
+                Get();
                 if(c != '\n') {
                     isafternewline = false;
                     continue;
@@ -374,13 +437,13 @@ private:
                 isafternewline = true;
             } else if(c == ',') {
                 if(!hadcomma) {
-                    f.get();
+                    Get();
                     hadcomma       = true;
                     isafternewline = false;
                     continue;
                 }
             } else if(c == '/') {
-                f.get();
+                Get();
                 isafterslash = true;
             }
             break;
@@ -399,7 +462,10 @@ private:
     int codeline;
     int _warnline;
     bool _abort_on_error;
-    std::ifstream f;
+    std::string buf; // whole file contents
+    bool isopen;
+    size_t pos;
+    bool iseof;
     std::string lastitem;
     int32_t lastitemcount;
     int line;
@@ -0,0 +1,161 @@
+/*
+bellhopcxx / bellhopcuda - C++/CUDA port of BELLHOP(3D) underwater acoustics simulator
+Copyright (C) 2021-2023 The Regents of the University of California
+Marine Physical Lab at Scripps Oceanography, c/o Jules Jaffe, jjaffe@ucsd.edu
+Based on BELLHOP / BELLHOP3D, which is Copyright (C) 1983-2022 Michael B. Porter
+
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#ifndef _BHC_INCLUDING_COMPONENTS_
+#error "Must be included from common_setup.hpp!"
+#endif
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace bhc {
+
+/**
+ * A file mapped read-write into memory. Writes to the memory go to the file;
+ * the OS pages the data in and out, so the file may be larger than RAM.
+ */
+class MappedFile {
+public:
+    MappedFile() : data(nullptr), size(0)
+    {
+#ifdef _WIN32
+        file    = INVALID_HANDLE_VALUE;
+        mapping = nullptr;
+#else
+        fd = -1;
+#endif
+    }
+    ~MappedFile() { Close(); }
+
+    /**
+     * Opens (or creates) the file at path, resizes it to bytes, and maps all of
+     * it. Any existing contents within bytes are kept, and the rest of the file
+     * is zero. Returns false on failure.
+     */
+    bool Open(const std::string &path, size_t bytes)
+    {
+        Close();
+        if(bytes == 0) return false;
+#ifdef _WIN32
+        file = CreateFileA(
+            path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER li;
+        li.QuadPart = (LONGLONG)bytes;
+        if(!SetFilePointerEx(file, li, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) {
+            Close();
+            return false;
+        }
+        mapping = CreateFileMappingA(
+            file, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)bytes >> 32),
+            (DWORD)(bytes & 0xFFFFFFFFull), nullptr);
+        if(mapping == nullptr) {
+            Close();
+            return false;
+        }
+        data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+        if(data == nullptr) {
+            Close();
+            return false;
+        }
+#else
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if(fd < 0) return false;
+        if(ftruncate(fd, (off_t)bytes) != 0) {
+            Close();
+            return false;
+        }
+        void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if(p == MAP_FAILED) {
+            Close();
+            return false;
+        }
+        data = p;
+#endif
+        size     = bytes;
+        filePath = path;
+        return true;
+    }
+
+    /**
+     * Writes all modified data back to the file. Returns false on failure.
+     */
+    bool Flush()
+    {
+        if(data == nullptr) return true;
+#ifdef _WIN32
+        return FlushViewOfFile(data, 0) && FlushFileBuffers(file);
+#else
+        return msync(data, size, MS_SYNC) == 0;
+#endif
+    }
+
+    /**
+     * Unmaps and closes the file. The data stays in the file.
+     */
+    void Close()
+    {
+#ifdef _WIN32
+        if(data != nullptr) UnmapViewOfFile(data);
+        if(mapping != nullptr) CloseHandle(mapping);
+        if(file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        file    = INVALID_HANDLE_VALUE;
+        mapping = nullptr;
+#else
+        if(data != nullptr) munmap(data, size);
+        if(fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+        data = nullptr;
+        size = 0;
+        filePath.clear();
+    }
+
+    bool IsOpen() const { return data != nullptr; }
+    void *Data() const { return data; }
+    size_t Size() const { return size; }
+    /// Path the file was opened with, empty if not open.
+    const std::string &Path() const { return filePath; }
+
+private:
+    MappedFile(const MappedFile &)            = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    void *data;
+    size_t size;
+    std::string filePath;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+};
+
+} // namespace bhc
@@ -0,0 +1,73 @@
+/*
+bellhopcxx / bellhopcuda - C++/CUDA port of BELLHOP(3D) underwater acoustics simulator
+Copyright (C) 2021-2023 The Regents of the University of California
+Marine Physical Lab at Scripps Oceanography, c/o Jules Jaffe, jjaffe@ucsd.edu
+Based on BELLHOP / BELLHOP3D, which is Copyright (C) 1983-2022 Michael B. Porter
+
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#ifndef _BHC_INCLUDING_COMPONENTS_
+#error "Must be included from common_setup.hpp!"
+#endif
+
+namespace bhc {
+
+/**
+ * Running 64-bit hash (FNV-1a over 64-bit words) of the parameters a module
+ * reads in Validate and Preprocess. run() compares this to the value after the
+ * previous run to decide whether the module needs to be validated and
+ * preprocessed again (see ParamsModule::Hash).
+ *
+ * Only add scalars and arrays of scalars, not whole structs, as padding bytes
+ * are not initialized.
+ */
+class ParamsHash {
+public:
+    ParamsHash() : h(0xCBF29CE484222325ull) {}
+
+    template<typename T> void Add(const T &v) { AddBytes(&v, sizeof(T)); }
+    template<typename T> void AddArray(const T *p, size_t n)
+    {
+        Add(n);
+        if(p != nullptr) AddBytes(p, n * sizeof(T));
+    }
+    void AddBytes(const void *data, size_t n)
+    {
+        const uint8_t *d = (const uint8_t *)data;
+        for(; n >= 8; n -= 8, d += 8) {
+            uint64_t w;
+            memcpy(&w, d, 8);
+            Mix(w);
+        }
+        if(n > 0) {
+            uint64_t w = 0;
+            memcpy(&w, d, n);
+            Mix(w ^ ((uint64_t)n << 56));
+        }
+    }
+    uint64_t Value() const { return h; }
+
+private:
+    inline void Mix(uint64_t w)
+    {
+        h ^= w;
+        h *= 0x100000001B3ull;
+        h ^= h >> 29;
+    }
+
+    uint64_t h;
+};
+
+} // namespace bhc
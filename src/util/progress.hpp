@@ -0,0 +1,79 @@
+/*
+bellhopcxx / bellhopcuda - C++/CUDA port of BELLHOP(3D) underwater acoustics simulator
+Copyright (C) 2021-2023 The Regents of the University of California
+Marine Physical Lab at Scripps Oceanography, c/o Jules Jaffe, jjaffe@ucsd.edu
+Based on BELLHOP / BELLHOP3D, which is Copyright (C) 1983-2022 Michael B. Porter
+
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#ifndef _BHC_INCLUDING_COMPONENTS_
+#error "Must be included from common.hpp!"
+#endif
+
+namespace bhc {
+
+/**
+ * Progress of the current bhc::run or bhc::writeout, as reported by
+ * bhc::get_percent_progress.
+ *
+ * The work is split into consecutive phases, each of which covers a fixed span
+ * of the percentage. Within a phase, progress is the fraction of its units of
+ * work which are done. Units may be added from any thread; phases are only
+ * started from the thread driving the run.
+ */
+class Progress {
+public:
+    Progress() : base(0), span(0), done(0), total(1) {}
+
+    /// Start a phase covering [basePercent, basePercent + spanPercent], made
+    /// up of totalUnits units of work.
+    inline void Phase(int32_t basePercent, int32_t spanPercent, int64_t totalUnits = 1)
+    {
+        done.store(0, std::memory_order_relaxed);
+        total.store(std::max(totalUnits, (int64_t)1), std::memory_order_relaxed);
+        span.store(spanPercent, std::memory_order_relaxed);
+        base.store(basePercent, std::memory_order_release);
+    }
+    /// Change the number of units of work in the current phase, once it is
+    /// known; the units done so far are discarded.
+    inline void SetUnits(int64_t totalUnits)
+    {
+        int32_t b = base.load(std::memory_order_relaxed);
+        int32_t s = span.load(std::memory_order_relaxed);
+        Phase(b, s, totalUnits);
+    }
+    inline void Add(int64_t units) { done.fetch_add(units, std::memory_order_relaxed); }
+    inline void Finish() { Phase(100, 0); }
+
+    inline int32_t Percent() const
+    {
+        int32_t b = base.load(std::memory_order_acquire);
+        int32_t s = span.load(std::memory_order_relaxed);
+        int64_t d = done.load(std::memory_order_relaxed);
+        int64_t t = total.load(std::memory_order_relaxed);
+        int32_t p = b + (int32_t)((int64_t)s * std::min(d, t) / t);
+        return std::min(std::max(p, 0), 100);
+    }
+
+private:
+    std::atomic<int32_t> base, span;
+    std::atomic<int64_t> done, total;
+};
+
+/// Percentages at which the phases of bhc::run start.
+constexpr int32_t ProgressRunBase  = 5;
+constexpr int32_t ProgressPostBase = 90;
+
+} // namespace bhc
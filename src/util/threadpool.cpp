@@ -0,0 +1,109 @@
+/*
+bellhopcxx / bellhopcuda - C++/CUDA port of BELLHOP(3D) underwater acoustics simulator
+Copyright (C) 2021-2023 The Regents of the University of California
+Marine Physical Lab at Scripps Oceanography, c/o Jules Jaffe, jjaffe@ucsd.edu
+Based on BELLHOP / BELLHOP3D, which is Copyright (C) 1983-2022 Michael B. Porter
+
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "../common_setup.hpp"
+
+namespace bhc {
+
+ThreadPool::ThreadPool(int32_t numThreads_)
+    : numThreads(numThreads_), generation(0), running(0), quit(false)
+{
+    for(int32_t i = 0; i < numThreads; ++i) {
+        threads.push_back(std::thread(&ThreadPool::WorkerMain, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    WaitIdle();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    startCV.notify_all();
+    for(auto &t : threads) t.join();
+}
+
+void ThreadPool::Start(std::function<void(int32_t)> task_)
+{
+    // LP: A previous non-blocking task may still be running. Any exception it
+    // threw has already been reported through the output callback, and there is
+    // nobody left to rethrow it to.
+    WaitIdle();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task          = std::move(task_);
+        taskException = nullptr;
+        running       = numThreads;
+        ++generation;
+    }
+    startCV.notify_all();
+}
+
+void ThreadPool::Wait()
+{
+    std::exception_ptr e;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCV.wait(lock, [this] { return running == 0; });
+        e             = taskException;
+        taskException = nullptr;
+    }
+    if(e) std::rethrow_exception(e);
+}
+
+void ThreadPool::WaitIdle()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCV.wait(lock, [this] { return running == 0; });
+}
+
+bool ThreadPool::Busy()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return running != 0;
+}
+
+void ThreadPool::WorkerMain(int32_t worker)
+{
+    SetupThread();
+    uint64_t lastGeneration = 0;
+    while(true) {
+        std::function<void(int32_t)> *t;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            startCV.wait(lock, [&] { return quit || generation != lastGeneration; });
+            if(quit) return;
+            lastGeneration = generation;
+            t              = &task;
+        }
+        // task is not modified until all threads have finished with it.
+        try {
+            (*t)(worker);
+        } catch(...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(!taskException) taskException = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(--running == 0) doneCV.notify_all();
+        }
+    }
+}
+
+} // namespace bhc
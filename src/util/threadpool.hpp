@@ -0,0 +1,77 @@
+/*
+bellhopcxx / bellhopcuda - C++/CUDA port of BELLHOP(3D) underwater acoustics simulator
+Copyright (C) 2021-2023 The Regents of the University of California
+Marine Physical Lab at Scripps Oceanography, c/o Jules Jaffe, jjaffe@ucsd.edu
+Based on BELLHOP / BELLHOP3D, which is Copyright (C) 1983-2022 Michael B. Porter
+
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#ifndef _BHC_INCLUDING_COMPONENTS_
+#error "Must be included from common.hpp!"
+#endif
+
+namespace bhc {
+
+/**
+ * Persistent set of CPU worker threads, owned by bhcInternal. The threads are
+ * created once in bhc::setup and joined in bhc::finalize, so repeated calls to
+ * bhc::run do not pay for thread creation or SetupThread each time.
+ *
+ * A task is a function which is called once on every thread of the pool, with
+ * the worker index (0 to NumThreads() - 1) as its argument. Only one task runs
+ * at a time; starting a new task waits for the previous one to finish.
+ */
+class ThreadPool {
+public:
+    ThreadPool(int32_t numThreads_);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &)            = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    inline int32_t NumThreads() const { return numThreads; }
+
+    /// Dispatch the task to all threads and return immediately.
+    void Start(std::function<void(int32_t)> task_);
+    /// Wait for the current task (if any) to complete on all threads, and
+    /// rethrow the first exception thrown by the task, if any.
+    void Wait();
+    /// Wait for the current task (if any) to complete on all threads, ignoring
+    /// any exception it threw.
+    void WaitIdle();
+    /// Start the task and wait for it to complete.
+    inline void Run(std::function<void(int32_t)> task_)
+    {
+        Start(std::move(task_));
+        Wait();
+    }
+    /// Whether a task is currently running on any thread.
+    bool Busy();
+
+private:
+    void WorkerMain(int32_t worker);
+
+    int32_t numThreads;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable startCV, doneCV;
+    std::function<void(int32_t)> task;
+    std::exception_ptr taskException;
+    uint64_t generation;
+    int32_t running;
+    bool quit;
+};
+
+} // namespace bhc